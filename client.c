@@ -0,0 +1,285 @@
+/* velox: client.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "client.h"
+#include "screen.h"
+#include "stats.h"
+#include "tag.h"
+
+#include <linux/sockios.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+
+struct wl_list clients = { &clients, &clients };
+
+static const char *const interface_names[NUM_CLIENT_INTERFACES] = {
+	[CLIENT_VELOX] = "velox",
+	[CLIENT_VELOX_SCREEN] = "velox_screen",
+	[CLIENT_VELOX_TAG] = "velox_tag",
+	[CLIENT_VELOX_SUBSCRIPTION] = "velox_subscription",
+	[CLIENT_VELOX_STATS] = "velox_stats",
+};
+
+static const enum stat_counter event_stats[NUM_CLIENT_INTERFACES] = {
+	[CLIENT_VELOX_SCREEN] = STAT_EVENTS_SCREEN,
+	[CLIENT_VELOX_TAG] = STAT_EVENTS_TAG,
+	[CLIENT_VELOX_SUBSCRIPTION] = STAT_EVENTS_SUBSCRIPTION,
+	[CLIENT_VELOX_STATS] = STAT_EVENTS_STATS,
+};
+
+static void
+unreference(struct client *client)
+{
+	if (--client->references > 0)
+		return;
+
+	wl_array_release(&client->screens);
+	free(client);
+}
+
+static void
+handle_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct client *client = wl_container_of(listener, client, destroy_listener);
+
+	client->client = NULL;
+	wl_list_remove(&client->link);
+
+	/* The client's resources are destroyed after its destroy listeners are
+	 * notified, so the record must outlive this. */
+	unreference(client);
+}
+
+struct client *
+client_get(struct wl_client *wl_client)
+{
+	static unsigned next_id = 1;
+	struct wl_listener *listener;
+	struct client *client;
+
+	listener = wl_client_get_destroy_listener(wl_client, &handle_client_destroy);
+	if (listener)
+		return wl_container_of(listener, client, destroy_listener);
+
+	if (!(client = malloc(sizeof(*client))))
+		return NULL;
+
+	client->references = 1;
+	client->id = next_id++;
+	client->client = wl_client;
+	memset(client->tags, 0, sizeof(client->tags));
+	wl_array_init(&client->screens);
+	memset(client->interfaces, 0, sizeof(client->interfaces));
+	client->max_queued = 0;
+	client->sent = false;
+	client->destroy_listener.notify = &handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->destroy_listener);
+	wl_list_insert(clients.prev, &client->link);
+
+	return client;
+}
+
+static struct wl_resource **
+screen_slot(struct client *client, unsigned id)
+{
+	size_t size = (id + 1) * sizeof(struct wl_resource *), old_size = client->screens.size;
+
+	if (old_size < size) {
+		if (!wl_array_add(&client->screens, size - old_size))
+			return NULL;
+		memset((char *)client->screens.data + old_size, 0, size - old_size);
+	}
+
+	return (struct wl_resource **)client->screens.data + id;
+}
+
+static void
+destroy_tag_resource(struct wl_resource *resource)
+{
+	struct client *client = wl_resource_get_user_data(resource);
+	unsigned index;
+
+	wl_list_remove(wl_resource_get_link(resource));
+
+	/* If the client bound the tag more than once, fall back to one of its other
+	 * resources. */
+	for (index = 0; index < NUM_TAGS; ++index) {
+		if (client->tags[index] == resource) {
+			client->tags[index] = wl_resource_find_for_client(&velox.tags[index]->resources,
+			                                                  wl_resource_get_client(resource));
+			break;
+		}
+	}
+
+	client_remove_resource(client, CLIENT_VELOX_TAG);
+}
+
+static void
+destroy_screen_resource(struct wl_resource *resource)
+{
+	struct client *client = wl_resource_get_user_data(resource);
+	struct wl_resource **slot;
+	struct screen *screen;
+
+	wl_list_remove(wl_resource_get_link(resource));
+
+	wl_list_for_each (screen, &velox.screens, link) {
+		if (screen->id * sizeof(*slot) >= client->screens.size)
+			continue;
+		slot = (struct wl_resource **)client->screens.data + screen->id;
+		if (*slot == resource) {
+			*slot = wl_resource_find_for_client(&screen->resources, wl_resource_get_client(resource));
+			break;
+		}
+	}
+
+	client_remove_resource(client, CLIENT_VELOX_SCREEN);
+}
+
+void
+client_add_tag(struct client *client, struct tag *tag, struct wl_resource *resource)
+{
+	struct wl_resource **slot = &client->tags[ffs(tag->mask) - 1];
+
+	wl_resource_set_user_data(resource, client);
+	wl_resource_set_destructor(resource, &destroy_tag_resource);
+	wl_list_insert(&tag->resources, wl_resource_get_link(resource));
+	client_add_resource(client, CLIENT_VELOX_TAG);
+
+	if (!*slot)
+		*slot = resource;
+}
+
+bool
+client_add_screen(struct client *client, struct screen *screen, struct wl_resource *resource)
+{
+	struct wl_resource **slot;
+
+	if (!(slot = screen_slot(client, screen->id)))
+		return false;
+
+	wl_resource_set_user_data(resource, client);
+	wl_resource_set_destructor(resource, &destroy_screen_resource);
+	wl_list_insert(&screen->resources, wl_resource_get_link(resource));
+	client_add_resource(client, CLIENT_VELOX_SCREEN);
+
+	if (!*slot)
+		*slot = resource;
+
+	return true;
+}
+
+struct wl_resource *
+client_tag(struct client *client, struct tag *tag)
+{
+	return client->tags[ffs(tag->mask) - 1];
+}
+
+struct wl_resource *
+client_screen(struct client *client, struct screen *screen)
+{
+	if (screen->id * sizeof(struct wl_resource *) >= client->screens.size)
+		return NULL;
+
+	return ((struct wl_resource **)client->screens.data)[screen->id];
+}
+
+void
+client_add_resource(struct client *client, enum client_interface interface)
+{
+	++client->references;
+	++client->interfaces[interface].resources;
+	++stats[STAT_RESOURCES];
+}
+
+void
+client_remove_resource(struct client *client, enum client_interface interface)
+{
+	--client->interfaces[interface].resources;
+	--stats[STAT_RESOURCES];
+	unreference(client);
+}
+
+void
+client_sent(struct client *client, enum client_interface interface, size_t size)
+{
+	++client->interfaces[interface].events;
+	client->interfaces[interface].bytes += size;
+	client->sent = true;
+	++stats[event_stats[interface]];
+}
+
+size_t
+wire_string(const char *string)
+{
+	return string ? WIRE_WORD + ((strlen(string) + 1 + WIRE_WORD - 1) & ~(WIRE_WORD - 1)) : WIRE_WORD;
+}
+
+void
+client_update_queued(void)
+{
+	struct client *client;
+	int queued;
+
+	wl_list_for_each (client, &clients, link) {
+		if (!client->sent)
+			continue;
+		client->sent = false;
+
+		/* Anything libwayland couldn't flush is still in its own buffer, but
+		 * once the socket is backed up, the client isn't keeping up. */
+		if (ioctl(wl_client_get_fd(client->client), SIOCOUTQ, &queued) == 0 && (unsigned)queued > client->max_queued)
+			client->max_queued = queued;
+	}
+}
+
+void
+client_print(void)
+{
+	struct client *client;
+	unsigned index;
+	pid_t pid;
+
+	fprintf(stderr, "%6s %8s %-20s %9s %10s %12s\n", "client", "pid", "interface", "resources", "events", "bytes");
+	wl_list_for_each (client, &clients, link) {
+		wl_client_get_credentials(client->client, &pid, NULL, NULL);
+		for (index = 0; index < NUM_CLIENT_INTERFACES; ++index) {
+			if (!client->interfaces[index].resources && !client->interfaces[index].events)
+				continue;
+			fprintf(stderr, "%6u %8ld %-20s %9u %10llu %12llu\n", client->id, (long)pid, interface_names[index],
+			        client->interfaces[index].resources,
+			        (unsigned long long)client->interfaces[index].events,
+			        (unsigned long long)client->interfaces[index].bytes);
+		}
+		fprintf(stderr, "%6u %8ld %-20s %u bytes\n", client->id, (long)pid, "max queued", client->max_queued);
+	}
+}
+
+const char *
+client_interface_name(enum client_interface interface)
+{
+	return interface_names[interface];
+}
@@ -0,0 +1,121 @@
+/* velox: client.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_CLIENT_H
+#define VELOX_CLIENT_H
+
+#include "velox.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server.h>
+
+struct screen;
+struct tag;
+
+enum client_interface {
+	CLIENT_VELOX,
+	CLIENT_VELOX_SCREEN,
+	CLIENT_VELOX_TAG,
+	CLIENT_VELOX_SUBSCRIPTION,
+	CLIENT_VELOX_STATS,
+	NUM_CLIENT_INTERFACES
+};
+
+/**
+ * Per-client record of the velox_tag and velox_screen resources bound by a
+ * client, so that the resource of one object can be found from another without
+ * walking the resource lists.
+ *
+ * The record also accounts for the protocol traffic of the client. It is freed
+ * once the client and all of its velox resources have been destroyed.
+ */
+struct client {
+	struct wl_listener destroy_listener;
+	unsigned references;
+	/* Unlike the pid, never reused by another client. */
+	unsigned id;
+	/* NULL once the client has been destroyed. */
+	struct wl_client *client;
+	struct wl_list link;
+
+	struct wl_resource *tags[NUM_TAGS];
+	/* Indexed by screen ID. */
+	struct wl_array screens;
+
+	struct {
+		unsigned resources;
+		uint64_t events, bytes;
+	} interfaces[NUM_CLIENT_INTERFACES];
+	/* The most data seen waiting in the socket after a flush. */
+	unsigned max_queued;
+	bool sent;
+};
+
+/* Live clients which have bound velox resources. */
+extern struct wl_list clients;
+
+/**
+ * Get the record for a client, creating it if necessary.
+ */
+struct client *client_get(struct wl_client *wl_client);
+
+/**
+ * Add a resource to the object's resource list and to the client's record.
+ *
+ * This sets the user data and destructor of the resource.
+ */
+void client_add_tag(struct client *client, struct tag *tag, struct wl_resource *resource);
+bool client_add_screen(struct client *client, struct screen *screen, struct wl_resource *resource);
+
+struct wl_resource *client_tag(struct client *client, struct tag *tag);
+struct wl_resource *client_screen(struct client *client, struct screen *screen);
+
+/**
+ * Account for a resource of some other velox interface. The record is kept
+ * until the resource is removed.
+ */
+void client_add_resource(struct client *client, enum client_interface interface);
+void client_remove_resource(struct client *client, enum client_interface interface);
+
+/**
+ * Account for an event sent to the client, of the given size on the wire.
+ */
+void client_sent(struct client *client, enum client_interface interface, size_t size);
+
+/* The size of the header and of arguments of an event on the wire. */
+#define WIRE_HEADER 8
+#define WIRE_WORD 4
+size_t wire_string(const char *string);
+
+/**
+ * Sample the socket queues of the clients sent events since the last call.
+ * This should be called after flushing the clients.
+ */
+void client_update_queued(void);
+
+void client_print(void);
+const char *client_interface_name(enum client_interface interface);
+
+#endif
@@ -0,0 +1,294 @@
+/* velox: clients/bench_status_bar.c
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Status bar rendering benchmark
+ *
+ * Drives the item drawing pipeline with synthetic tag, title and clock
+ * updates, rendering to offscreen pixman surfaces. */
+
+#include "status_bar.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wld/pixman.h>
+#include <wld/wld.h>
+
+#define NUM_TAGS 9
+#define MAX_SCREENS 8
+
+/* Count allocations by wrapping the glibc allocator. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *data, size_t size);
+
+static unsigned long allocations;
+
+void *
+malloc(size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size)
+{
+	++allocations;
+	return __libc_calloc(count, size);
+}
+
+void *
+realloc(void *data, size_t size)
+{
+	++allocations;
+	return __libc_realloc(data, size);
+}
+
+/* Configuration parameters */
+static const char *const font_name = "Terminus:pixelsize=14";
+static const uint32_t width = 1920;
+static const unsigned warmup_frames = 100;
+
+static const char *const titles[] = {
+	"vim status_bar.c",
+	"~/src/velox - st",
+	"velox/clients/draw.c at master · michaelforney/velox - Mozilla Firefox",
+	"htop",
+	/* Long enough to be cut short at the default width. */
+	"draw.c - velox - Visual Studio Code: a window title that goes on and on, "
+	"long past the point where it could possibly fit on the screen alongside "
+	"the tags, the status sources and the clock, so that it has to be elided "
+	"with an ellipsis before the right-aligned items, no matter how wide the "
+	"output happens to be",
+	"",
+};
+
+static struct tag tags[NUM_TAGS];
+static struct screen screens[MAX_SCREENS];
+static unsigned num_screens = 2;
+static struct group *group;
+static char clock_text[32];
+static struct text_item_data clock_data = {.text = clock_text };
+static struct item_data divider_data = {.width = 14 };
+
+void
+die(const char *const format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	fputs("FATAL: ", stderr);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+	va_end(args);
+	exit(EXIT_FAILURE);
+}
+
+void *
+xmalloc(size_t size)
+{
+	void *data;
+
+	if (!(data = malloc(size)))
+		die("Allocation failed");
+	return data;
+}
+
+static uint64_t
+get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+add_item(struct wl_list *items, const struct item_interface *interface, struct item_data *data)
+{
+	struct item *item = item_new(interface, data);
+
+	wl_list_insert(items->prev, &item->link);
+}
+
+static void
+setup(void)
+{
+	struct status_bar *bar;
+	struct screen *screen;
+	char name[4];
+	unsigned index, tag;
+
+	wld.context = wld_pixman_context;
+	if (!(wld.renderer = wld_create_renderer(wld.context)))
+		die("Failed to create WLD renderer");
+	if (!(wld.font_context = wld_font_create_context()))
+		die("Failed to create WLD font context");
+	if (!(wld.font = wld_font_open_name(wld.font_context, font_name)))
+		die("Failed to open font");
+
+	for (index = 0; index < NUM_TAGS; ++index) {
+		/* The protocol objects are only compared, so any unique pointer will
+		 * do. */
+		tags[index].velox = (struct velox_tag *)&tags[index];
+		snprintf(name, sizeof(name), "%u", index + 1);
+		tags[index].name = strdup(name);
+		tags[index].name_data.text = tags[index].name;
+		update_text_item_data(&tags[index].name_data);
+	}
+
+	group = group_new(width, wld.font->height + 2);
+	update_text_item_data(&clock_data);
+	add_item(&group->items, &text_interface, &clock_data.base);
+
+	for (index = 0; index < num_screens; ++index) {
+		screen = &screens[index];
+		screen->velox = (struct velox_screen *)screen;
+		screen->focus_data.base.text = "";
+		tags[index].screen = screen->velox;
+
+		bar = &screen->status_bar;
+		bar->width = group->width;
+		bar->height = group->height;
+		bar->wld_surface = wld_create_surface(wld.context, bar->width, bar->height, WLD_FORMAT_XRGB8888, 0);
+		if (!bar->wld_surface)
+			die("Failed to create surface");
+		bar->damaged = true;
+		pixman_region32_init(&bar->pending);
+		bar->group = group;
+		wl_list_insert(group->bars.prev, &bar->group_link);
+
+		wl_list_init(&bar->items[ALIGN_LEFT]);
+		wl_list_init(&bar->items[ALIGN_CENTER]);
+		for (tag = 0; tag < NUM_TAGS; ++tag)
+			add_item(&bar->items[ALIGN_LEFT], &tag_interface, &tags[tag].name_data.base);
+		add_item(&bar->items[ALIGN_LEFT], &divider_interface, &divider_data);
+		add_item(&bar->items[ALIGN_LEFT], &title_interface, &screen->focus_data.base.base);
+	}
+}
+
+/* Apply the synthetic changes for one frame. */
+static void
+update(unsigned frame)
+{
+	struct screen *screen = &screens[frame % num_screens];
+	time_t time = 1400000000 + frame;
+	struct tm tm;
+	unsigned old, new;
+
+	/* The clock ticks every frame. */
+	gmtime_r(&time, &tm);
+	strftime(clock_text, sizeof(clock_text), "%A %T %F", &tm);
+	update_text_item_data(&clock_data);
+
+	/* The focused window changes every few frames. */
+	if (frame % 3 == 0) {
+		screen->focus_data.base.text = titles[frame / 3 % ARRAY_LENGTH(titles)];
+		update_title_item_data(&screen->focus_data);
+	}
+
+	/* Windows are opened and closed on a tag. */
+	if (frame % 16 == 0) {
+		tags[frame / 16 % NUM_TAGS].num_windows ^= 1;
+		item_data_changed(&tags[frame / 16 % NUM_TAGS].name_data.base);
+	}
+
+	/* The first screen switches tags. */
+	if (frame % 64 == 0) {
+		for (old = 0; tags[old].screen != screens[0].velox; ++old)
+			;
+		for (new = (old + 1) % NUM_TAGS; tags[new].screen; new = (new + 1) % NUM_TAGS)
+			;
+		tags[old].screen = NULL;
+		tags[new].screen = screens[0].velox;
+		screens[0].focus.tag = tags[new].velox;
+		item_data_changed(&tags[old].name_data.base);
+		item_data_changed(&tags[new].name_data.base);
+	}
+}
+
+static void
+draw(void)
+{
+	struct status_bar *bar;
+	pixman_region32_t damage;
+	unsigned index;
+
+	group_draw(group);
+	for (index = 0; index < num_screens; ++index) {
+		bar = &screens[index].status_bar;
+		pixman_region32_union(&bar->pending, &bar->pending, &group->damage);
+		pixman_region32_init(&damage);
+		if (bar_draw(bar, &damage))
+			wld_swap(bar->wld_surface);
+		pixman_region32_fini(&damage);
+	}
+	need_draw = false;
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned frame, num_frames = 10000;
+	uint64_t start, end;
+	unsigned long start_allocations;
+
+	if (argc > 1)
+		num_frames = strtoul(argv[1], NULL, 10);
+	if (argc > 2) {
+		num_screens = strtoul(argv[2], NULL, 10);
+		if (num_screens < 1 || num_screens > MAX_SCREENS)
+			die("Number of screens must be between 1 and %u", MAX_SCREENS);
+	}
+	if (num_frames == 0)
+		die("Number of frames must be positive");
+
+	setup();
+
+	for (frame = 0; frame < warmup_frames; ++frame) {
+		update(frame);
+		draw();
+	}
+
+	pixels_drawn = 0;
+	start_allocations = allocations;
+	start = get_time();
+
+	for (; frame < warmup_frames + num_frames; ++frame) {
+		update(frame);
+		draw();
+	}
+
+	end = get_time();
+
+	printf("%u frames, %u screens\n", num_frames, num_screens);
+	printf("%.2f us/frame\n", (double)(end - start) / num_frames);
+	printf("%.0f bytes/frame\n", (double)pixels_drawn * 4 / num_frames);
+	printf("%.2f allocations/frame\n", (double)(allocations - start_allocations) / num_frames);
+	print_text_cache_statistics();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,599 @@
+/* velox: clients/draw.c
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "status_bar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wld/wld.h>
+
+/* A cached text string, along with its extents and the glyph runs rendered
+ * for it in each style. */
+struct text {
+	struct text *next;
+	struct wl_list link;
+	uint32_t hash;
+	struct wld_font *font;
+	uint32_t advance;
+
+	struct {
+		const struct style *style;
+		struct wld_buffer *buffer;
+	} runs[2];
+
+	size_t size, length;
+	char data[];
+};
+
+static void title_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
+static void tag_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
+static void divider_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
+
+const struct item_interface text_interface = {
+	.draw = &text_draw
+};
+
+const struct item_interface title_interface = {
+	.draw = &title_draw
+};
+
+const struct item_interface tag_interface = {
+	.draw = &tag_draw
+};
+
+const struct item_interface divider_interface = {
+	.draw = &divider_draw
+};
+
+/* Configuration parameters */
+static const int spacing = 12;
+const struct style normal = { .bg = 0xff1a1a1a, .fg = 0xff999999 };
+const struct style selected = { .bg = 0xff338833, .fg = 0xffffffff };
+static const size_t text_cache_size = 1 << 20;
+static const char *const ellipsis = "...";
+
+struct wld wld;
+bool need_draw;
+uint64_t pixels_drawn;
+
+/* The current render target, restored after rendering glyph runs. */
+static struct {
+	struct wld_surface *surface;
+	struct wld_buffer *buffer;
+} target;
+
+/* Text cache, with entries in least-recently-used order. */
+static struct {
+	struct text *table[256];
+	struct wl_list lru;
+	size_t size;
+	struct {
+		unsigned long hits, misses;
+	} extents, runs;
+} text_cache = {
+	.lru = { &text_cache.lru, &text_cache.lru },
+};
+
+struct item *
+item_new(const struct item_interface *interface, const struct item_data *data)
+{
+	struct item *item;
+
+	if (!(item = malloc(sizeof(*item))))
+		die("Failed to allocate item");
+
+	item->interface = interface;
+	item->data = data;
+	item->x = 0;
+	item->width = 0;
+	item->serial = data->serial - 1;
+
+	return item;
+}
+
+static uint32_t
+text_hash(struct wld_font *font, const char *data, size_t length)
+{
+	uint32_t hash = 2166136261u ^ (uintptr_t)font;
+	size_t index;
+
+	for (index = 0; index < length; ++index) {
+		hash ^= (unsigned char)data[index];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static void
+text_evict(struct text *text)
+{
+	struct text **link = &text_cache.table[text->hash % ARRAY_LENGTH(text_cache.table)];
+	unsigned index;
+
+	while (*link != text)
+		link = &(*link)->next;
+	*link = text->next;
+
+	for (index = 0; index < ARRAY_LENGTH(text->runs); ++index) {
+		if (text->runs[index].buffer)
+			wld_buffer_unreference(text->runs[index].buffer);
+	}
+
+	wl_list_remove(&text->link);
+	text_cache.size -= text->size;
+	free(text);
+}
+
+static void
+text_cache_trim(void)
+{
+	struct text *text;
+
+	while (text_cache.size > text_cache_size && !wl_list_empty(&text_cache.lru)) {
+		text = wl_container_of(text_cache.lru.prev, text, link);
+		text_evict(text);
+	}
+}
+
+/* Look up a string in the text cache, measuring it if it is not present. */
+static struct text *
+text_lookup(const char *data, size_t length)
+{
+	uint32_t hash = text_hash(wld.font, data, length);
+	struct text **head = &text_cache.table[hash % ARRAY_LENGTH(text_cache.table)], *text;
+	struct wld_extents extents;
+
+	for (text = *head; text; text = text->next) {
+		if (text->hash == hash && text->font == wld.font && text->length == length
+		    && memcmp(text->data, data, length) == 0) {
+			++text_cache.extents.hits;
+			wl_list_remove(&text->link);
+			wl_list_insert(&text_cache.lru, &text->link);
+			return text;
+		}
+	}
+
+	++text_cache.extents.misses;
+	text = xmalloc(sizeof(*text) + length + 1);
+	memcpy(text->data, data, length);
+	text->data[length] = '\0';
+	text->length = length;
+	text->hash = hash;
+	text->font = wld.font;
+	memset(text->runs, 0, sizeof(text->runs));
+	wld_font_text_extents_n(wld.font, data, length, &extents);
+	text->advance = extents.advance;
+	text->size = sizeof(*text) + length + 1;
+
+	text->next = *head;
+	*head = text;
+	wl_list_insert(&text_cache.lru, &text->link);
+	text_cache.size += text->size;
+	text_cache_trim();
+
+	return text;
+}
+
+/* Draw a cached string with its top-left corner at (x, y), rendering its glyph
+ * run first if necessary. */
+static void
+text_blit(struct status_bar *bar, struct text *text, const struct style *style, int32_t x, int32_t y)
+{
+	struct wld_buffer *buffer;
+	unsigned index;
+
+	if (text->advance == 0)
+		return;
+
+	for (index = 0; index < ARRAY_LENGTH(text->runs); ++index) {
+		if (text->runs[index].style == style) {
+			++text_cache.runs.hits;
+			buffer = text->runs[index].buffer;
+			goto copy;
+		}
+	}
+
+	++text_cache.runs.misses;
+	buffer = wld_create_buffer(wld.context, text->advance, wld.font->height, WLD_FORMAT_XRGB8888, 0);
+	if (!buffer) {
+		wld_draw_text(wld.renderer, wld.font, style->fg, x, y + wld.font->ascent,
+		              text->data, text->length, NULL);
+		return;
+	}
+
+	wld_set_target_buffer(wld.renderer, buffer);
+	wld_fill_rectangle(wld.renderer, style->bg, 0, 0, text->advance, wld.font->height);
+	wld_draw_text(wld.renderer, wld.font, style->fg, 0, wld.font->ascent, text->data, text->length, NULL);
+	wld_flush(wld.renderer);
+	if (target.buffer)
+		wld_set_target_buffer(wld.renderer, target.buffer);
+	else
+		wld_set_target_surface(wld.renderer, target.surface);
+
+	/* Use a free slot, or replace the first run. */
+	index = text->runs[0].buffer && !text->runs[1].buffer;
+	if (text->runs[index].buffer) {
+		wld_buffer_unreference(text->runs[index].buffer);
+		text->size -= text->advance * wld.font->height * 4;
+		text_cache.size -= text->advance * wld.font->height * 4;
+	}
+	text->runs[index].style = style;
+	text->runs[index].buffer = buffer;
+	text->size += text->advance * wld.font->height * 4;
+	text_cache.size += text->advance * wld.font->height * 4;
+
+copy:
+	wld_copy_rectangle(wld.renderer, buffer, x, y, 0, 0, text->advance, wld.font->height);
+
+	/* Only trim after copying, since this entry may be the one evicted. */
+	text_cache_trim();
+}
+
+void
+item_data_changed(struct item_data *data)
+{
+	++data->serial;
+	need_draw = true;
+}
+
+void
+update_text_item_data(struct text_item_data *data)
+{
+	data->base.width = text_lookup(data->text, strlen(data->text))->advance + spacing;
+	item_data_changed(&data->base);
+}
+
+/* Lay out a title within its maximum width, finding the longest prefix that
+ * fits along with the ellipsis. Returns whether the shown text changed. */
+static bool
+title_layout(struct title_item_data *data)
+{
+	const struct title_boundary *boundaries = data->boundaries;
+	uint32_t advance = boundaries[data->num_boundaries - 1].advance, available;
+	size_t length = boundaries[data->num_boundaries - 1].offset;
+	size_t low, high, middle;
+	bool elided = false;
+	struct text *text;
+
+	if (data->max_width && advance + spacing > data->max_width) {
+		text = text_lookup(ellipsis, strlen(ellipsis));
+		available = data->max_width > text->advance + spacing ? data->max_width - text->advance - spacing : 0;
+
+		/* Find the last boundary that fits. The first is always at 0. */
+		for (low = 0, high = data->num_boundaries - 1; low < high;) {
+			middle = high - (high - low) / 2;
+			if (boundaries[middle].advance <= available)
+				low = middle;
+			else
+				high = middle - 1;
+		}
+
+		length = boundaries[low].offset;
+		advance = boundaries[low].advance + text->advance;
+		elided = true;
+	}
+
+	if (data->length == length && data->elided == elided && data->base.base.width == advance + spacing)
+		return false;
+
+	data->length = length;
+	data->elided = elided;
+	data->base.base.width = advance + spacing;
+
+	return true;
+}
+
+/* Measure each character of a new title. */
+void
+update_title_item_data(struct title_item_data *data)
+{
+	const char *text = data->base.text;
+	size_t length = strlen(text), offset, start;
+	struct wld_extents extents;
+	uint32_t advance = 0;
+
+	data->boundaries = realloc(data->boundaries, (length + 1) * sizeof(data->boundaries[0]));
+	if (!data->boundaries)
+		die("Failed to allocate title boundaries");
+	data->boundaries[0].offset = 0;
+	data->boundaries[0].advance = 0;
+	data->num_boundaries = 1;
+
+	for (start = 0; start < length; start = offset) {
+		/* Skip over UTF-8 continuation bytes. */
+		for (offset = start + 1; offset < length && (text[offset] & 0xc0) == 0x80; ++offset)
+			;
+		wld_font_text_extents_n(wld.font, text + start, offset - start, &extents);
+		advance += extents.advance;
+		data->boundaries[data->num_boundaries].offset = offset;
+		data->boundaries[data->num_boundaries].advance = advance;
+		++data->num_boundaries;
+	}
+
+	title_layout(data);
+	item_data_changed(&data->base.base);
+}
+
+/* Limit the width of a title. This is done while drawing, so only the serial
+ * is updated. */
+static void
+title_set_max_width(struct title_item_data *data, uint32_t max_width)
+{
+	if (data->max_width == max_width)
+		return;
+
+	data->max_width = max_width;
+	if (data->num_boundaries > 0 && title_layout(data))
+		++data->base.base.serial;
+}
+
+/* Item implementations */
+void
+text_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+{
+	struct text_item_data *data = (void *)item->data;
+
+	text_blit(bar, text_lookup(data->text, strlen(data->text)), &normal, x, y + 1);
+}
+
+static void
+title_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+{
+	struct title_item_data *data = (void *)item->data;
+	struct text *text;
+
+	text = text_lookup(data->base.text, data->length);
+	text_blit(bar, text, &normal, x, y + 1);
+	if (data->elided)
+		text_blit(bar, text_lookup(ellipsis, strlen(ellipsis)), &normal, x + text->advance, y + 1);
+}
+
+static void
+divider_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+{
+	wld_fill_rectangle(wld.renderer, normal.fg, x + spacing / 2, y, 2, bar->height);
+}
+
+static void
+tag_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+{
+	struct tag *tag = wl_container_of(item->data, tag, name_data);
+	struct screen *screen = wl_container_of(bar, screen, status_bar);
+	const struct style *style;
+
+	style = tag->screen == screen->velox ? &selected : &normal;
+	wld_fill_rectangle(wld.renderer, style->bg, x, y, item->data->width, bar->height);
+	if (tag->num_windows > 0)
+		wld_fill_rectangle(wld.renderer, style->fg, x, y, item->data->width, 1);
+	if (tag->velox == screen->focus.tag) {
+		wld_fill_rectangle(wld.renderer, style->fg, x, y + 1, 3, 1);
+		wld_fill_rectangle(wld.renderer, style->fg, x, y + 2, 2, 1);
+		wld_fill_rectangle(wld.renderer, style->fg, x, y + 3, 1, 1);
+	}
+
+	text_blit(bar, text_lookup(tag->name_data.text, strlen(tag->name_data.text)), style,
+	          x + spacing / 2, y + 1);
+}
+
+static void
+set_target_surface(struct wld_surface *surface)
+{
+	target.surface = surface;
+	target.buffer = NULL;
+	wld_set_target_surface(wld.renderer, surface);
+}
+
+static void
+set_target_buffer(struct wld_buffer *buffer)
+{
+	target.buffer = buffer;
+	wld_set_target_buffer(wld.renderer, buffer);
+}
+
+/* Damage the old and new spans of every item that changed or moved since it was
+ * last drawn. */
+static void
+damage_items(struct wl_list *items, uint32_t x, uint32_t height, pixman_region32_t *damage)
+{
+	struct item *item;
+
+	wl_list_for_each (item, items, link) {
+		if (item->x != x || item->width != item->data->width || item->serial != item->data->serial) {
+			pixman_region32_union_rect(damage, damage, item->x, 0, item->width, height);
+			pixman_region32_union_rect(damage, damage, x, 0, item->data->width, height);
+			item->x = x;
+			item->width = item->data->width;
+			item->serial = item->data->serial;
+		}
+		x += item->data->width;
+	}
+}
+
+static void
+draw_items(struct status_bar *bar, struct wl_list *items, pixman_region32_t *repaint)
+{
+	struct item *item;
+
+	wl_list_for_each (item, items, link) {
+		pixman_box32_t extents = { item->x, 0, item->x + item->width, bar->height };
+
+		if (item->width > 0 && pixman_region32_contains_rectangle(repaint, &extents) != PIXMAN_REGION_OUT)
+			item->interface->draw(bar, item, item->x, 0);
+	}
+}
+
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	pixman_box32_t *box, *end;
+	uint64_t area = 0;
+	int num_boxes;
+
+	box = pixman_region32_rectangles(region, &num_boxes);
+	for (end = box + num_boxes; box < end; ++box)
+		area += (uint64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+
+	return area;
+}
+
+struct group *
+group_new(uint32_t width, uint32_t height)
+{
+	struct group *group;
+
+	group = xmalloc(sizeof(*group));
+	group->width = width;
+	group->height = height;
+	group->canvas = wld_create_buffer(wld.context, width, height, WLD_FORMAT_XRGB8888, 0);
+	if (!group->canvas)
+		die("Failed to create shared canvas");
+	group->damaged = true;
+	group->x = width;
+	pixman_region32_init(&group->damage);
+	wl_list_init(&group->items);
+	wl_list_init(&group->bars);
+
+	return group;
+}
+
+void
+group_destroy(struct group *group)
+{
+	struct item *item, *next;
+
+	wl_list_for_each_safe (item, next, &group->items, link)
+		free(item);
+	wld_buffer_unreference(group->canvas);
+	pixman_region32_fini(&group->damage);
+	free(group);
+}
+
+/* Bring the group canvas up to date, recording the area redrawn. */
+void
+group_draw(struct group *group)
+{
+	struct status_bar *leader;
+	struct item *item;
+
+	pixman_region32_clear(&group->damage);
+	if (wl_list_empty(&group->bars))
+		return;
+
+	group->x = group->width;
+	wl_list_for_each (item, &group->items, link)
+		group->x -= item->data->width;
+
+	if (group->damaged) {
+		pixman_region32_union_rect(&group->damage, &group->damage, 0, 0, group->width, group->height);
+		group->damaged = false;
+	}
+
+	damage_items(&group->items, group->x, group->height, &group->damage);
+
+	if (!pixman_region32_not_empty(&group->damage))
+		return;
+
+	/* Any bar in the group will do for the item draw functions. */
+	leader = wl_container_of(group->bars.next, leader, group_link);
+
+	set_target_buffer(group->canvas);
+	wld_fill_region(wld.renderer, normal.bg, &group->damage);
+	draw_items(leader, &group->items, &group->damage);
+	wld_flush(wld.renderer);
+	pixels_drawn += region_area(&group->damage);
+}
+
+/* Draw everything in a bar that changed since it was last drawn, and set damage
+ * to the area changed. Returns false if nothing changed. */
+bool
+bar_draw(struct status_bar *bar, pixman_region32_t *damage)
+{
+	struct group *group = bar->group;
+	struct item *item;
+	uint32_t start_x[2] = { 0, bar->width / 2 }, x;
+	unsigned align;
+	pixman_region32_t shared, *repaint;
+	pixman_box32_t *box, *end;
+	int num_boxes;
+
+	/* Fit the title between the left-aligned items and the shared ones. */
+	x = 0;
+	wl_list_for_each (item, &bar->items[ALIGN_LEFT], link) {
+		if (item->interface == &title_interface)
+			title_set_max_width((void *)item->data, group->x > x ? group->x - x : 1);
+		x += item->data->width;
+	}
+
+	wl_list_for_each (item, &bar->items[ALIGN_CENTER], link)
+		start_x[ALIGN_CENTER] -= item->data->width / 2;
+
+	if (bar->damaged) {
+		pixman_region32_union_rect(damage, damage, 0, 0, bar->width, bar->height);
+		bar->damaged = false;
+	}
+
+	for (align = 0; align < ARRAY_LENGTH(bar->items); ++align)
+		damage_items(&bar->items[align], start_x[align], bar->height, damage);
+	pixman_region32_union(damage, damage, &bar->pending);
+	pixman_region32_clear(&bar->pending);
+
+	if (!pixman_region32_not_empty(damage))
+		return false;
+
+	/* The back buffer may be older than the last frame, so repaint everything
+	 * damaged since it was last presented. */
+	if (!(repaint = wld_surface_damage(bar->wld_surface, damage)))
+		repaint = damage;
+
+	set_target_surface(bar->wld_surface);
+	wld_fill_region(wld.renderer, normal.bg, repaint);
+	pixels_drawn += region_area(repaint);
+
+	for (align = 0; align < ARRAY_LENGTH(bar->items); ++align)
+		draw_items(bar, &bar->items[align], repaint);
+
+	/* Copy the shared items from the group canvas. */
+	pixman_region32_init(&shared);
+	pixman_region32_intersect_rect(&shared, repaint, group->x, 0, group->width - group->x, group->height);
+	box = pixman_region32_rectangles(&shared, &num_boxes);
+	for (end = box + num_boxes; box < end; ++box) {
+		wld_copy_rectangle(wld.renderer, group->canvas, box->x1, box->y1,
+		                   box->x1, box->y1, box->x2 - box->x1, box->y2 - box->y1);
+	}
+	pixels_drawn += region_area(&shared);
+	pixman_region32_fini(&shared);
+
+	wld_flush(wld.renderer);
+
+	return true;
+}
+
+void
+print_text_cache_statistics(void)
+{
+	fprintf(stderr, "status bar: text cache: extents %lu hits, %lu misses; runs %lu hits, %lu misses\n",
+	        text_cache.extents.hits, text_cache.extents.misses,
+	        text_cache.runs.hits, text_cache.runs.misses);
+}
@@ -0,0 +1,459 @@
+/* velox: clients/external.c
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* External status input
+ *
+ * Reads status text from a child process (VELOX_STATUS_COMMAND) or a FIFO
+ * (VELOX_STATUS_FIFO). Each line is either plain text, or an i3bar-style JSON
+ * array of blocks, in which case the full_text of each block is shown. */
+
+#include "status_bar.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BUFFER_SIZE 4096
+#define MAX_BLOCKS 16
+#define MAX_READS 4
+
+struct block {
+	struct text_item_data data;
+	char text[128];
+};
+
+/* A position within the ring buffer while parsing a line. */
+struct cursor {
+	unsigned position, end;
+};
+
+static const struct item_interface block_interface = {
+	.draw = &text_draw
+};
+
+static struct {
+	struct watch watch;
+	/* A signalfd for SIGCHLD while the command is running. */
+	struct watch child;
+	pid_t pid;
+
+	/* The ring buffer. Positions are free-running and masked on access. */
+	char buffer[BUFFER_SIZE];
+	unsigned head, tail, scan;
+	/* Set when a line did not fit in the buffer and the rest of it should be
+	 * thrown away. */
+	bool discarding;
+
+	struct block blocks[MAX_BLOCKS];
+	unsigned num_blocks;
+} external;
+
+static inline char
+ring_at(unsigned position)
+{
+	return external.buffer[position % BUFFER_SIZE];
+}
+
+static bool
+block_set_text(struct block *block, const char *text)
+{
+	if (strcmp(text, block->text) == 0)
+		return false;
+
+	snprintf(block->text, sizeof(block->text), "%s", text);
+	if (block->text[0]) {
+		update_text_item_data(&block->data);
+	} else {
+		block->data.base.width = 0;
+		item_data_changed(&block->data.base);
+	}
+
+	return true;
+}
+
+/* Parsing */
+static inline bool
+cursor_done(struct cursor *cursor)
+{
+	return cursor->position == cursor->end;
+}
+
+static inline char
+cursor_peek(struct cursor *cursor)
+{
+	return cursor_done(cursor) ? '\0' : ring_at(cursor->position);
+}
+
+static void
+skip_space(struct cursor *cursor)
+{
+	while (!cursor_done(cursor) && strchr(" \t\r,", ring_at(cursor->position)))
+		++cursor->position;
+}
+
+/* Parse a JSON string, writing at most size - 1 bytes to text if it is not
+ * NULL. Only ASCII \u escapes are decoded. */
+static bool
+parse_string(struct cursor *cursor, char *text, size_t size)
+{
+	size_t length = 0;
+	unsigned code, index;
+	char c;
+
+	if (cursor_peek(cursor) != '"')
+		return false;
+	++cursor->position;
+
+	while (!cursor_done(cursor)) {
+		c = ring_at(cursor->position++);
+
+		if (c == '"')
+			goto done;
+
+		if (c == '\\') {
+			if (cursor_done(cursor))
+				break;
+			switch (c = ring_at(cursor->position++)) {
+			case 'n': c = ' '; break;
+			case 't': c = ' '; break;
+			case 'r': case 'b': case 'f': continue;
+			case 'u':
+				for (code = 0, index = 0; index < 4 && !cursor_done(cursor); ++index) {
+					c = ring_at(cursor->position++);
+					code = code << 4 | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+				}
+				c = code < 0x80 ? code : '?';
+				break;
+			}
+		}
+
+		if (text && length + 1 < size)
+			text[length++] = c;
+	}
+
+	return false;
+
+done:
+	if (text)
+		text[length] = '\0';
+	return true;
+}
+
+/* Skip over any JSON value, including nested objects and arrays. */
+static bool
+skip_value(struct cursor *cursor)
+{
+	unsigned depth = 0;
+	char c;
+
+	do {
+		skip_space(cursor);
+		switch (c = cursor_peek(cursor)) {
+		case '\0':
+			return false;
+		case '"':
+			if (!parse_string(cursor, NULL, 0))
+				return false;
+			break;
+		case '{': case '[':
+			++depth;
+			/* fallthrough */
+		case ':':
+			++cursor->position;
+			break;
+		case '}': case ']':
+			if (depth == 0)
+				return true;
+			--depth;
+			++cursor->position;
+			break;
+		default:
+			while (!cursor_done(cursor) && !strchr(",]} \t", cursor_peek(cursor)))
+				++cursor->position;
+			break;
+		}
+	} while (depth > 0);
+
+	return true;
+}
+
+static bool
+parse_block(struct cursor *cursor, char *text, size_t size)
+{
+	char key[16];
+
+	text[0] = '\0';
+	if (cursor_peek(cursor) != '{')
+		return false;
+	++cursor->position;
+
+	while (true) {
+		skip_space(cursor);
+		if (cursor_peek(cursor) == '}') {
+			++cursor->position;
+			return true;
+		}
+		if (!parse_string(cursor, key, sizeof(key)))
+			return false;
+		skip_space(cursor);
+		if (cursor_peek(cursor) != ':')
+			return false;
+		++cursor->position;
+		skip_space(cursor);
+
+		if (strcmp(key, "full_text") == 0) {
+			if (!parse_string(cursor, text, size))
+				return false;
+		} else if (!skip_value(cursor)) {
+			return false;
+		}
+	}
+}
+
+static void
+handle_line(struct cursor *cursor)
+{
+	char text[sizeof(external.blocks[0].text)];
+	unsigned index = 0, length;
+
+	skip_space(cursor);
+
+	switch (cursor_peek(cursor)) {
+	case '{':
+		/* The i3bar protocol header. */
+		return;
+	case '[':
+		++cursor->position;
+		for (skip_space(cursor); cursor_peek(cursor) == '{' && index < MAX_BLOCKS; skip_space(cursor)) {
+			if (!parse_block(cursor, text, sizeof(text)))
+				return;
+			block_set_text(&external.blocks[index++], text);
+		}
+
+		/* The opening line of the infinite array has no blocks. */
+		if (index == 0 && cursor_peek(cursor) != ']')
+			return;
+		break;
+	default:
+		for (length = 0; !cursor_done(cursor) && length + 1 < sizeof(text); ++length)
+			text[length] = ring_at(cursor->position++);
+		text[length] = '\0';
+		block_set_text(&external.blocks[index++], text);
+		break;
+	}
+
+	for (; index < external.num_blocks; ++index)
+		block_set_text(&external.blocks[index], "");
+}
+
+/* Reap the command if it has exited, without waiting for it. */
+static bool
+reap(void)
+{
+	pid_t pid = waitpid(external.pid, NULL, WNOHANG);
+
+	if (pid == 0 || (pid == -1 && errno == EINTR))
+		return false;
+
+	external.pid = 0;
+	return true;
+}
+
+static void
+handle_child(struct watch *watch)
+{
+	struct signalfd_siginfo info;
+
+	while (read(watch->fd, &info, sizeof(info)) > 0)
+		;
+	if (external.pid > 0 && !reap())
+		return;
+
+	watch_remove(watch);
+	close(watch->fd);
+}
+
+static void
+stop(void)
+{
+	watch_remove(&external.watch);
+	close(external.watch.fd);
+
+	/* A command may close its output and keep running, so only reap it if it
+	 * is already gone. Otherwise, it is reaped when SIGCHLD arrives. */
+	if (external.pid > 0)
+		reap();
+}
+
+static void
+handle_input(struct watch *watch)
+{
+	struct iovec iov[2];
+	struct cursor line = { 0, 0 };
+	unsigned reads, offset, space;
+	bool have_line = false;
+	ssize_t length;
+
+	/* Bound the work done for a single wakeup so that a producer writing
+	 * faster than we can read does not starve the display connection. */
+	for (reads = 0; reads < MAX_READS; ++reads) {
+		/* Keep the most recent complete line intact until it is parsed. */
+		if (have_line && external.tail - line.position == BUFFER_SIZE) {
+			handle_line(&line);
+			have_line = false;
+		}
+
+		offset = external.tail % BUFFER_SIZE;
+		space = BUFFER_SIZE - (external.tail - (have_line ? line.position : external.head));
+		iov[0].iov_base = &external.buffer[offset];
+		iov[0].iov_len = space < BUFFER_SIZE - offset ? space : BUFFER_SIZE - offset;
+		iov[1].iov_base = external.buffer;
+		iov[1].iov_len = space - iov[0].iov_len;
+
+		length = readv(watch->fd, iov, 2);
+		if (length == 0 || (length == -1 && errno != EAGAIN && errno != EINTR)) {
+			stop();
+			break;
+		}
+		if (length == -1)
+			break;
+		external.tail += length;
+
+		/* Find complete lines. Only the most recent one matters. */
+		for (; external.scan != external.tail; ++external.scan) {
+			if (ring_at(external.scan) != '\n')
+				continue;
+			if (external.discarding) {
+				external.discarding = false;
+			} else {
+				line.position = external.head;
+				line.end = external.scan;
+				have_line = true;
+			}
+			external.head = external.scan + 1;
+		}
+
+		/* The buffer is full without a complete line. */
+		if (external.tail - external.head == BUFFER_SIZE) {
+			external.discarding = true;
+			external.head = external.tail;
+		}
+	}
+
+	if (have_line)
+		handle_line(&line);
+}
+
+static int
+spawn(const char *command)
+{
+	sigset_t mask;
+	int fds[2];
+
+	/* Block SIGCHLD so that it is only seen through the signalfd. */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1)
+		goto error0;
+	if ((external.child.fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+		goto error0;
+	if (pipe(fds) == -1)
+		goto error1;
+
+	switch (external.pid = fork()) {
+	case -1:
+		goto error2;
+	case 0:
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+		close(fds[0]);
+		if (fds[1] != STDOUT_FILENO) {
+			dup2(fds[1], STDOUT_FILENO);
+			close(fds[1]);
+		}
+		execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+		_exit(EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	external.child.handle = &handle_child;
+	watch_add(&external.child);
+
+	return fds[0];
+
+error2:
+	close(fds[0]);
+	close(fds[1]);
+error1:
+	close(external.child.fd);
+error0:
+	return -1;
+}
+
+void
+external_initialize(void)
+{
+	const char *command, *path;
+	unsigned index;
+	int fd;
+
+	if ((command = getenv("VELOX_STATUS_COMMAND"))) {
+		if ((fd = spawn(command)) == -1)
+			die("Failed to run status command: %s", strerror(errno));
+	} else if ((path = getenv("VELOX_STATUS_FIFO"))) {
+		/* Open for writing too, so that we don't see end-of-file when a
+		 * writer closes the FIFO. */
+		if ((fd = open(path, O_RDWR)) == -1)
+			die("Failed to open status FIFO: %s", strerror(errno));
+	} else {
+		return;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	for (index = 0; index < MAX_BLOCKS; ++index)
+		external.blocks[index].data.text = external.blocks[index].text;
+	external.num_blocks = MAX_BLOCKS;
+	external.watch.fd = fd;
+	external.watch.handle = &handle_input;
+	watch_add(&external.watch);
+}
+
+void
+external_add_items(struct wl_list *items)
+{
+	struct item *item;
+	unsigned index;
+
+	for (index = 0; index < external.num_blocks; ++index) {
+		item = item_new(&block_interface, &external.blocks[index].data.base);
+		wl_list_insert(items->prev, &item->link);
+	}
+}
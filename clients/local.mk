@@ -3,12 +3,19 @@
 dir := clients
 
 $(dir)_TARGETS := $(dir)/status_bar
-$(dir)_PACKAGES := pixman-1 wld wayland-client
+$(dir)_PACKAGES := fontconfig pixman-1 wld wayland-client
 
 $(dir)/status_bar.o: $(call client_protocol,velox swc)
 
-$(dir)/status_bar: $(dir)/status_bar.o $(call protocol,velox swc)
-	$(link) $(clients_PACKAGE_LIBS) -lrt
+$(dir)/status_bar: $(dir)/status_bar.o $(dir)/draw.o $(dir)/sources.o $(dir)/external.o $(call protocol,velox swc)
+	$(link) $(clients_PACKAGE_LIBS)
+
+$(dir)/bench_status_bar: $(dir)/bench_status_bar.o $(dir)/draw.o
+	$(link) $(clients_PACKAGE_LIBS)
+
+.PHONY: bench-status-bar
+bench-status-bar: $(dir)/bench_status_bar
+	./$<
 
 install-clients: $($(dir)_TARGETS) | $(DESTDIR)$(LIBEXECDIR)/velox
 	install -m 755 $^ $(DESTDIR)$(LIBEXECDIR)/velox
@@ -0,0 +1,466 @@
+/* velox: clients/sources.c
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "status_bar.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+struct source {
+	struct text_item_data data;
+	char text[64];
+	bool active;
+};
+
+/* Configuration parameters */
+static const unsigned sample_interval = 2;
+static const char *const battery_path = "/sys/class/power_supply/BAT0";
+
+static void
+source_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+{
+	text_draw(bar, item, x, y);
+}
+
+static const struct item_interface source_interface = {
+	.draw = &source_draw
+};
+
+static struct watch sample_watch;
+static bool sampling, sample_paused;
+
+static struct {
+	struct source source;
+	int fd;
+	unsigned long long busy, total;
+} cpu;
+
+static struct {
+	struct source source;
+	int fd;
+} memory;
+
+static struct {
+	struct source source;
+	struct watch watch;
+	int capacity_fd, status_fd;
+} battery;
+
+static struct {
+	struct source source;
+	struct watch watch;
+	uint32_t seq;
+	bool dumping, changed;
+	char address[64];
+} network;
+
+/* Sources listed in VELOX_STATUS_DISABLE, a comma separated list of cpu,
+ * memory, battery and network, are never shown or sampled. */
+static bool
+source_disabled(const char *name)
+{
+	const char *list = getenv("VELOX_STATUS_DISABLE");
+	size_t length = strlen(name);
+
+	while (list && *list) {
+		if (strncmp(list, name, length) == 0 && (list[length] == ',' || list[length] == '\0'))
+			return true;
+		if ((list = strchr(list, ',')))
+			++list;
+	}
+
+	return false;
+}
+
+/* Update the text of a source, only marking it as changed if it differs. */
+static void __attribute__((format(printf, 2, 3)))
+source_set_text(struct source *source, const char *format, ...)
+{
+	char text[sizeof(source->text)];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+
+	if (strcmp(text, source->text) == 0)
+		return;
+
+	strcpy(source->text, text);
+	update_text_item_data(&source->data);
+}
+
+static void
+source_initialize(struct source *source)
+{
+	source->text[0] = '\0';
+	source->data.text = source->text;
+	source->data.base.width = 0;
+	source->data.base.serial = 0;
+	source->active = true;
+}
+
+/* Read the contents of a file that is kept open. */
+static ssize_t
+read_file(int fd, char *buffer, size_t size)
+{
+	ssize_t length;
+
+	if ((length = pread(fd, buffer, size - 1, 0)) < 0)
+		return length;
+	buffer[length] = '\0';
+
+	return length;
+}
+
+/* CPU usage from /proc/stat */
+static void
+cpu_update(void)
+{
+	char buffer[256];
+	unsigned long long fields[8] = { 0 }, busy, total;
+	unsigned index;
+
+	if (read_file(cpu.fd, buffer, sizeof(buffer)) <= 0)
+		return;
+	if (sscanf(buffer, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+	           &fields[0], &fields[1], &fields[2], &fields[3],
+	           &fields[4], &fields[5], &fields[6], &fields[7]) < 4) {
+		return;
+	}
+
+	for (total = 0, index = 0; index < ARRAY_LENGTH(fields); ++index)
+		total += fields[index];
+	/* Idle and I/O wait time. */
+	busy = total - fields[3] - fields[4];
+
+	if (total > cpu.total) {
+		source_set_text(&cpu.source, "cpu %llu%%",
+		                100 * (busy - cpu.busy) / (total - cpu.total));
+	}
+
+	cpu.busy = busy;
+	cpu.total = total;
+}
+
+/* Memory usage from /proc/meminfo */
+static void
+memory_update(void)
+{
+	char buffer[1024], *s;
+	unsigned long long total, available;
+
+	if (read_file(memory.fd, buffer, sizeof(buffer)) <= 0)
+		return;
+	if (!(s = strstr(buffer, "MemTotal:")) || sscanf(s, "MemTotal: %llu", &total) != 1)
+		return;
+	if (!(s = strstr(buffer, "MemAvailable:")) || sscanf(s, "MemAvailable: %llu", &available) != 1)
+		return;
+	if (total == 0)
+		return;
+
+	source_set_text(&memory.source, "mem %llu%%", 100 * (total - available) / total);
+}
+
+/* Battery from sysfs */
+static void
+battery_update(void)
+{
+	char capacity[16], status[32];
+	const char *sign = "";
+
+	if (read_file(battery.capacity_fd, capacity, sizeof(capacity)) <= 0)
+		return;
+	capacity[strcspn(capacity, "\n")] = '\0';
+
+	if (read_file(battery.status_fd, status, sizeof(status)) > 0) {
+		if (strncmp(status, "Charging", 8) == 0)
+			sign = "+";
+		else if (strncmp(status, "Discharging", 11) == 0)
+			sign = "-";
+	}
+
+	source_set_text(&battery.source, "bat %s%s%%", sign, capacity);
+}
+
+static void
+battery_handle(struct watch *watch)
+{
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	/* We don't care which file changed, just drain the events. */
+	while (read(watch->fd, buffer, sizeof(buffer)) > 0)
+		;
+	battery_update();
+}
+
+static bool
+battery_initialize(void)
+{
+	char path[256];
+
+	snprintf(path, sizeof(path), "%s/capacity", battery_path);
+	if ((battery.capacity_fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		goto error0;
+	if ((battery.watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1)
+		goto error1;
+	inotify_add_watch(battery.watch.fd, path, IN_MODIFY);
+
+	snprintf(path, sizeof(path), "%s/status", battery_path);
+	if ((battery.status_fd = open(path, O_RDONLY | O_CLOEXEC)) != -1)
+		inotify_add_watch(battery.watch.fd, path, IN_MODIFY);
+
+	battery.watch.handle = &battery_handle;
+	watch_add(&battery.watch);
+
+	return true;
+
+error1:
+	close(battery.capacity_fd);
+error0:
+	return false;
+}
+
+/* Network from rtnetlink */
+static void
+network_request(void)
+{
+	struct {
+		struct nlmsghdr header;
+		struct ifaddrmsg message;
+	} request = {
+		.header = {
+			.nlmsg_len = sizeof(request),
+			.nlmsg_type = RTM_GETADDR,
+			.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+			.nlmsg_seq = ++network.seq,
+		},
+		.message = { .ifa_family = AF_INET },
+	};
+
+	if (send(network.watch.fd, &request, sizeof(request), 0) == -1)
+		return;
+
+	network.dumping = true;
+	network.changed = false;
+	network.address[0] = '\0';
+}
+
+static void
+network_address(struct nlmsghdr *header)
+{
+	struct ifaddrmsg *message = NLMSG_DATA(header);
+	struct rtattr *attribute;
+	int length = IFA_PAYLOAD(header);
+	const char *label = NULL;
+	char address[INET_ADDRSTRLEN] = "";
+
+	/* Skip loopback addresses, and only use the first address found. */
+	if (message->ifa_scope == RT_SCOPE_HOST || network.address[0])
+		return;
+
+	for (attribute = IFA_RTA(message); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+		switch (attribute->rta_type) {
+		case IFA_LABEL:
+			label = RTA_DATA(attribute);
+			break;
+		case IFA_LOCAL:
+			inet_ntop(AF_INET, RTA_DATA(attribute), address, sizeof(address));
+			break;
+		}
+	}
+
+	if (label && address[0])
+		snprintf(network.address, sizeof(network.address), "%s %s", label, address);
+}
+
+static void
+network_handle(struct watch *watch)
+{
+	char buffer[8192] __attribute__((aligned(__alignof__(struct nlmsghdr))));
+	struct nlmsghdr *header;
+	ssize_t length;
+
+	while ((length = recv(watch->fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+		for (header = (void *)buffer; NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+			/* Any notification means we need to take a new snapshot. */
+			if (!network.dumping || header->nlmsg_seq != network.seq) {
+				network.changed = true;
+				continue;
+			}
+
+			switch (header->nlmsg_type) {
+			case RTM_NEWADDR:
+				network_address(header);
+				break;
+			case NLMSG_DONE:
+			case NLMSG_ERROR:
+				network.dumping = false;
+				source_set_text(&network.source, "net %s", network.address[0] ? network.address : "down");
+				break;
+			}
+		}
+	}
+
+	if (network.changed && !network.dumping)
+		network_request();
+}
+
+static bool
+network_initialize(void)
+{
+	struct sockaddr_nl address = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR,
+	};
+
+	network.watch.fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+	if (network.watch.fd == -1)
+		goto error0;
+	if (bind(network.watch.fd, (struct sockaddr *)&address, sizeof(address)) == -1)
+		goto error1;
+
+	network.watch.handle = &network_handle;
+	watch_add(&network.watch);
+	network.seq = 0;
+	network_request();
+
+	return true;
+
+error1:
+	close(network.watch.fd);
+error0:
+	return false;
+}
+
+static void
+schedule_sample(bool enable)
+{
+	struct itimerspec value = {
+		.it_interval = { enable ? sample_interval : 0, 0 },
+		.it_value = { enable ? sample_interval : 0, 0 },
+	};
+
+	timerfd_settime(sample_watch.fd, 0, &value, NULL);
+}
+
+static void
+sample(void)
+{
+	if (cpu.source.active)
+		cpu_update();
+	if (memory.source.active)
+		memory_update();
+	/* Not every power supply driver notifies sysfs attribute changes. */
+	if (battery.source.active)
+		battery_update();
+}
+
+static void
+sample_handle(struct watch *watch)
+{
+	uint64_t expirations;
+
+	read(watch->fd, &expirations, sizeof(expirations));
+
+	/* There is nothing to show the values on, so stop sampling until there is. */
+	if (!bars_visible()) {
+		sample_paused = true;
+		schedule_sample(false);
+		return;
+	}
+
+	sample();
+}
+
+void
+sources_initialize(void)
+{
+	source_initialize(&cpu.source);
+	if (source_disabled("cpu") || (cpu.fd = open("/proc/stat", O_RDONLY | O_CLOEXEC)) == -1)
+		cpu.source.active = false;
+
+	source_initialize(&memory.source);
+	if (source_disabled("memory") || (memory.fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC)) == -1)
+		memory.source.active = false;
+
+	source_initialize(&battery.source);
+	if (source_disabled("battery") || !battery_initialize())
+		battery.source.active = false;
+
+	source_initialize(&network.source);
+	if (source_disabled("network") || !network_initialize())
+		network.source.active = false;
+
+	/* Without a polled source, there is no need to wake up at all. */
+	sampling = cpu.source.active || memory.source.active || battery.source.active;
+	if (!sampling)
+		return;
+
+	sample_watch.fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (sample_watch.fd == -1)
+		die("Failed to create timer: %s", strerror(errno));
+	sample_watch.handle = &sample_handle;
+	watch_add(&sample_watch);
+
+	sample();
+	schedule_sample(true);
+}
+
+void
+sources_add_items(struct wl_list *items)
+{
+	struct source *sources[] = { &cpu.source, &memory.source, &battery.source, &network.source };
+	struct item *item;
+	unsigned index;
+
+	for (index = 0; index < ARRAY_LENGTH(sources); ++index) {
+		if (!sources[index]->active)
+			continue;
+		item = item_new(&source_interface, &sources[index]->data.base);
+		wl_list_insert(items->prev, &item->link);
+	}
+}
+
+void
+sources_resume(void)
+{
+	if (!sampling || !sample_paused)
+		return;
+
+	sample_paused = false;
+	sample();
+	schedule_sample(true);
+}
@@ -22,82 +22,24 @@
  */
 
 #include <errno.h>
-#include <signal.h>
+#include <fontconfig/fontconfig.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <poll.h>
-#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <time.h>
+#include <unistd.h>
 #include <wayland-client.h>
 #include <wld/wayland.h>
 #include <wld/wld.h>
 
+#include "status_bar.h"
 #include "protocol/swc-client-protocol.h"
 #include "protocol/velox-client-protocol.h"
 
-enum align {
-	ALIGN_LEFT,
-	ALIGN_CENTER,
-	ALIGN_RIGHT,
-};
-
-struct item {
-	const struct item_interface *interface;
-	const struct item_data *data;
-	struct wl_list link;
-};
-
-struct item_data {
-	uint32_t width;
-};
-
-struct text_item_data {
-	struct item_data base;
-	const char *text;
-};
-
-struct status_bar {
-	struct wl_surface *surface;
-	struct swc_panel *panel;
-
-	struct wld_surface *wld_surface;
-	uint32_t width, height;
-
-	struct wl_list items[3];
-};
-
-struct item_interface {
-	void (*draw)(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
-};
-
-struct style {
-	uint32_t fg, bg;
-};
-
-struct tag {
-	struct velox_tag *velox;
-	struct velox_screen *screen;
-	struct wl_list link;
-
-	struct text_item_data name_data;
-	char *name;
-	unsigned num_windows;
-};
-
-struct screen {
-	struct swc_screen *swc;
-	struct velox_screen *velox;
-	struct status_bar status_bar;
-	struct wl_list link;
-
-	struct text_item_data focus_data;
-	struct {
-		char *title;
-		struct velox_tag *tag;
-	} focus;
-};
-
 /* Wayland listeners */
 static void registry_global(void *data, struct wl_registry *registry,
                             uint32_t name, const char *implementation, uint32_t version);
@@ -105,30 +47,20 @@ static void registry_global_remove(void *data, struct wl_registry *registry, uin
 
 static void panel_docked(void *data, struct swc_panel *panel, uint32_t length);
 
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time);
+
 static void velox_screen_focus(void *data, struct velox_screen *velox_screen, const char *title, struct velox_tag *tag);
 static void velox_tag_name(void *data, struct velox_tag *tag, const char *name);
 static void velox_tag_state(void *data, struct velox_tag *tag, uint32_t num_windows);
 static void velox_tag_screen(void *data, struct velox_tag *tag, struct velox_screen *screen);
 
-/* Item interfaces */
-static void text_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
-static void tag_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
-static void divider_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
-
 static struct wl_display *display;
 static struct wl_registry *registry;
 static struct wl_compositor *compositor;
 static struct swc_panel_manager *panel_manager;
 static struct velox *velox;
 
-static struct wl_list screens, tags;
-
-static struct {
-	struct wld_context *context;
-	struct wld_renderer *renderer;
-	struct wld_font_context *font_context;
-	struct wld_font *font;
-} wld;
+static struct wl_list screens, tags, watches, groups;
 
 static const struct wl_registry_listener registry_listener = {
 	.global = &registry_global,
@@ -139,6 +71,10 @@ static const struct swc_panel_listener panel_listener = {
 	.docked = &panel_docked
 };
 
+static const struct wl_callback_listener frame_listener = {
+	.done = &frame_done
+};
+
 static const struct velox_screen_listener velox_screen_listener = {
 	.focus = &velox_screen_focus,
 };
@@ -149,31 +85,26 @@ static const struct velox_tag_listener velox_tag_listener = {
 	.screen = &velox_tag_screen,
 };
 
-static const struct item_interface text_interface = {
-	.draw = &text_draw
-};
-
-static const struct item_interface tag_interface = {
-	.draw = &tag_draw
-};
-
-static const struct item_interface divider_interface = {
-	.draw = &divider_draw
-};
-
 /* Configuration parameters */
-static const int spacing = 12;
 static const char *const font_name = "Terminus:pixelsize=14";
-static const struct style normal = { .bg = 0xff1a1a1a, .fg = 0xff999999 };
-static const struct style selected = { .bg = 0xff338833, .fg = 0xffffffff };
+static const char *const clock_format = "%A %T %F";
 
-static timer_t timer;
-static bool running, need_draw;
+static bool running, first_frame;
+static uint64_t start_time;
+static struct watch clock_watch;
+static bool clock_paused;
 static char clock_text[32];
 static struct item_data divider_data = {.width = 14 };
 static struct text_item_data clock_data = {.text = clock_text };
 
-static void __attribute__((noreturn)) die(const char *const format, ...)
+static struct {
+	unsigned long draws, deferred;
+	/* In microseconds, from when a change was noticed until it was drawn. */
+	uint64_t latency_total, latency_max;
+} draw_stats;
+
+void
+die(const char *const format, ...)
 {
 	va_list args;
 
@@ -185,7 +116,7 @@ static void __attribute__((noreturn)) die(const char *const format, ...)
 	exit(EXIT_FAILURE);
 }
 
-static void *
+void *
 xmalloc(size_t size)
 {
 	void *data;
@@ -195,28 +126,147 @@ xmalloc(size_t size)
 	return data;
 }
 
-static struct item *
-item_new(const struct item_interface *interface, const struct item_data *data)
+static void
+tag_changed(struct velox_tag *velox_tag)
 {
-	struct item *item;
+	struct tag *tag;
+
+	if (!velox_tag)
+		return;
 
-	if (!(item = malloc(sizeof(*item))))
-		die("Failed to allocate item");
+	wl_list_for_each (tag, &tags, link) {
+		if (tag->velox == velox_tag) {
+			item_data_changed(&tag->name_data.base);
+			break;
+		}
+	}
+}
 
-	item->interface = interface;
-	item->data = data;
+/* Clock */
+enum clock_unit {
+	CLOCK_SECOND,
+	CLOCK_MINUTE,
+	CLOCK_HOUR,
+	CLOCK_DAY,
+};
 
-	return item;
+/* Find the smallest unit of time displayed by a strftime format. */
+static enum clock_unit
+clock_unit(const char *format)
+{
+	enum clock_unit unit = CLOCK_DAY;
+
+	while ((format = strchr(format, '%'))) {
+		/* Skip flags, field width and modifiers. */
+		format += 1 + strspn(format + 1, "_-0^#0123456789EO");
+
+		switch (*format) {
+		case 'S': case 'T': case 'X': case 'c': case 'r': case 's': case '+':
+			return CLOCK_SECOND;
+		case 'M': case 'R':
+			unit = CLOCK_MINUTE;
+			break;
+		case 'H': case 'I': case 'k': case 'l': case 'p': case 'P':
+			if (unit > CLOCK_HOUR)
+				unit = CLOCK_HOUR;
+			break;
+		case '\0':
+			return unit;
+		}
+		++format;
+	}
+
+	return unit;
 }
 
 static void
-update_text_item_data(struct text_item_data *data)
+update_clock(void)
 {
-	struct wld_extents extents;
+	time_t raw_time = time(NULL);
+	struct tm local_time;
 
-	wld_font_text_extents(wld.font, data->text, &extents);
-	data->base.width = extents.advance + spacing;
-	need_draw = true;
+	localtime_r(&raw_time, &local_time);
+	strftime(clock_text, sizeof(clock_text), clock_format, &local_time);
+	update_text_item_data(&clock_data);
+}
+
+/* Arm the clock timer for the next time the displayed text can change. */
+static void
+schedule_clock(void)
+{
+	struct itimerspec value = { 0 };
+	time_t now = time(NULL);
+	struct tm next;
+	enum clock_unit unit = clock_unit(clock_format);
+
+	localtime_r(&now, &next);
+
+	switch (unit) {
+	case CLOCK_DAY:
+		next.tm_hour = 0;
+		/* fallthrough */
+	case CLOCK_HOUR:
+		next.tm_min = 0;
+		/* fallthrough */
+	case CLOCK_MINUTE:
+		next.tm_sec = 0;
+		/* fallthrough */
+	case CLOCK_SECOND:
+		break;
+	}
+
+	switch (unit) {
+	case CLOCK_SECOND:
+		++next.tm_sec;
+		break;
+	case CLOCK_MINUTE:
+		++next.tm_min;
+		break;
+	case CLOCK_HOUR:
+		++next.tm_hour;
+		break;
+	case CLOCK_DAY:
+		++next.tm_mday;
+		break;
+	}
+
+	next.tm_isdst = -1;
+	value.it_value.tv_sec = mktime(&next);
+	timerfd_settime(clock_watch.fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &value, NULL);
+}
+
+/* A bar whose frame callback is still pending is on an output that is idle, or
+ * is otherwise hidden. */
+bool
+bars_visible(void)
+{
+	struct screen *screen;
+
+	wl_list_for_each (screen, &screens, link) {
+		if (!screen->status_bar.frame)
+			return true;
+	}
+
+	return false;
+}
+
+static void
+handle_clock(struct watch *watch)
+{
+	uint64_t expirations;
+
+	/* This fails with ECANCELED if the system clock was changed, in which case
+	 * we just reschedule. */
+	read(watch->fd, &expirations, sizeof(expirations));
+
+	/* Don't wake up again until a bar is visible. */
+	if (!bars_visible()) {
+		clock_paused = true;
+		return;
+	}
+
+	update_clock();
+	schedule_clock();
 }
 
 /* Wayland event handlers */
@@ -232,7 +282,13 @@ registry_global(void *data, struct wl_registry *registry,
 		struct screen *screen;
 
 		screen = xmalloc(sizeof(*screen));
-		screen->focus_data.text = "";
+		screen->focus_data.base.text = "";
+		screen->focus_data.base.base.serial = 0;
+		screen->focus_data.boundaries = NULL;
+		screen->focus_data.num_boundaries = 0;
+		screen->focus_data.max_width = 0;
+		screen->focus_data.length = 0;
+		screen->focus_data.elided = false;
 		screen->focus.title = NULL;
 		screen->focus.tag = NULL;
 		screen->swc = wl_registry_bind(registry, name, &swc_screen_interface, 1);
@@ -248,6 +304,7 @@ registry_global(void *data, struct wl_registry *registry,
 		tag->name = NULL;
 		tag->name_data.text = "";
 		tag->name_data.base.width = 0;
+		tag->name_data.base.serial = 0;
 		tag->screen = NULL;
 		tag->num_windows = 0;
 		tag->velox = wl_registry_bind(registry, name, &velox_tag_interface, 1);
@@ -263,6 +320,31 @@ registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
 {
 }
 
+static struct group *
+group_get(uint32_t width, uint32_t height)
+{
+	struct group *group;
+	struct item *item;
+
+	wl_list_for_each (group, &groups, link) {
+		if (group->width == width && group->height == height)
+			return group;
+	}
+
+	group = group_new(width, height);
+	wl_list_insert(groups.prev, &group->link);
+
+	/* Status sources */
+	sources_add_items(&group->items);
+	external_add_items(&group->items);
+
+	/* Clock */
+	item = item_new(&text_interface, &clock_data.base);
+	wl_list_insert(group->items.prev, &item->link);
+
+	return group;
+}
+
 static void
 panel_docked(void *data, struct swc_panel *panel, uint32_t length)
 {
@@ -270,8 +352,46 @@ panel_docked(void *data, struct swc_panel *panel, uint32_t length)
 
 	bar->width = length;
 	bar->height = wld.font->height + 2;
+
+	if (bar->group && (bar->group->width != bar->width || bar->group->height != bar->height)) {
+		wl_list_remove(&bar->group_link);
+		if (wl_list_empty(&bar->group->bars)) {
+			wl_list_remove(&bar->group->link);
+			group_destroy(bar->group);
+		}
+		bar->group = NULL;
+	}
+	if (!bar->group) {
+		bar->group = group_get(bar->width, bar->height);
+		wl_list_insert(bar->group->bars.prev, &bar->group_link);
+	}
+
+	if (bar->wld_surface)
+		wld_destroy_surface(bar->wld_surface);
 	bar->wld_surface = wld_wayland_create_surface(wld.context, bar->width, bar->height,
 	                                              WLD_FORMAT_XRGB8888, 0, bar->surface);
+	if (!bar->wld_surface)
+		die("Failed to create surface");
+	swc_panel_set_strut(bar->panel, bar->height, 0, bar->width);
+	bar->damaged = true;
+	need_draw = true;
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct status_bar *bar = data;
+
+	wl_callback_destroy(callback);
+	bar->frame = NULL;
+
+	if (clock_paused) {
+		clock_paused = false;
+		update_clock();
+		schedule_clock();
+	}
+
+	sources_resume();
 }
 
 static void
@@ -291,6 +411,7 @@ velox_tag_state(void *data, struct velox_tag *velox_tag, uint32_t num_windows)
 	struct tag *tag = data;
 
 	tag->num_windows = num_windows;
+	item_data_changed(&tag->name_data.base);
 }
 
 static void
@@ -299,7 +420,7 @@ velox_tag_screen(void *data, struct velox_tag *velox_tag, struct velox_screen *v
 	struct tag *tag = data;
 
 	tag->screen = velox_screen;
-	need_draw = true;
+	item_data_changed(&tag->name_data.base);
 }
 
 static void
@@ -317,87 +438,176 @@ velox_screen_focus(void *data, struct velox_screen *velox_screen, const char *ti
 		title = "";
 	}
 
+	if (tag != screen->focus.tag) {
+		tag_changed(screen->focus.tag);
+		tag_changed(tag);
+	}
+
 	screen->focus.tag = tag;
-	screen->focus_data.text = title;
-	update_text_item_data(&screen->focus_data);
+	screen->focus_data.base.text = title;
+	update_title_item_data(&screen->focus_data);
 }
 
-/* Item implementations */
 void
-text_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+watch_add(struct watch *watch)
 {
-	struct text_item_data *data = (void *)item->data;
-
-	wld_draw_text(wld.renderer, wld.font, normal.fg, x, y + wld.font->ascent + 1, data->text, -1, NULL);
+	wl_list_insert(watches.prev, &watch->link);
 }
 
 void
-divider_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+watch_remove(struct watch *watch)
 {
-	wld_fill_rectangle(wld.renderer, normal.fg, x + spacing / 2, y, 2, bar->height);
+	wl_list_remove(&watch->link);
 }
 
-void
-tag_draw(struct status_bar *bar, struct item *item, uint32_t x, uint32_t y)
+static uint64_t
+get_time(void)
 {
-	struct tag *tag = wl_container_of(item->data, tag, name_data);
-	struct screen *screen = wl_container_of(bar, screen, status_bar);
-	const struct style *style;
-
-	style = tag->screen == screen->velox ? &selected : &normal;
-	wld_fill_rectangle(wld.renderer, style->bg, x, y, item->data->width, bar->height);
-	if (tag->num_windows > 0)
-		wld_fill_rectangle(wld.renderer, style->fg, x, y, item->data->width, 1);
-	if (tag->velox == screen->focus.tag) {
-		wld_fill_rectangle(wld.renderer, style->fg, x, y + 1, 3, 1);
-		wld_fill_rectangle(wld.renderer, style->fg, x, y + 2, 2, 1);
-		wld_fill_rectangle(wld.renderer, style->fg, x, y + 3, 1, 1);
-	}
+	struct timespec ts;
 
-	x += spacing / 2;
-	y += wld.font->ascent + 1;
-	wld_draw_text(wld.renderer, wld.font, style->fg, x, y, tag->name_data.text, -1, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+log_phase(const char *phase)
+{
+	fprintf(stderr, "status bar: %s at %.1f ms\n", phase, (get_time() - start_time) / 1000.0);
 }
 
 static void
 draw(struct status_bar *bar)
 {
-	struct item *item;
-	uint32_t start_x[3] = {
-		0, bar->width / 2, bar->width
-	};
-	uint32_t x;
+	pixman_region32_t damage;
+	pixman_box32_t *box, *end;
+	int num_boxes;
 
-	wld_set_target_surface(wld.renderer, bar->wld_surface);
-	wld_fill_rectangle(wld.renderer, normal.bg, 0, 0, bar->width, bar->height);
+	pixman_region32_init(&damage);
+	if (!bar_draw(bar, &damage))
+		goto done;
 
-	wl_list_for_each (item, &bar->items[ALIGN_CENTER], link)
-		start_x[ALIGN_CENTER] -= item->data->width / 2;
+	box = pixman_region32_rectangles(&damage, &num_boxes);
+	for (end = box + num_boxes; box < end; ++box)
+		wl_surface_damage(bar->surface, box->x1, box->y1, box->x2 - box->x1, box->y2 - box->y1);
 
-	wl_list_for_each (item, &bar->items[ALIGN_RIGHT], link)
-		start_x[ALIGN_RIGHT] -= item->data->width;
+	bar->frame = wl_surface_frame(bar->surface);
+	wl_callback_add_listener(bar->frame, &frame_listener, bar);
 
-	x = start_x[ALIGN_LEFT];
-	wl_list_for_each (item, &bar->items[ALIGN_LEFT], link) {
-		item->interface->draw(bar, item, x, 0);
-		x += item->data->width;
+	wld_swap(bar->wld_surface);
+
+	if (!first_frame) {
+		first_frame = true;
+		log_phase("first frame");
 	}
 
-	x = start_x[ALIGN_CENTER];
-	wl_list_for_each (item, &bar->items[ALIGN_CENTER], link) {
-		item->interface->draw(bar, item, x, 0);
-		x += item->data->width;
+done:
+	pixman_region32_fini(&damage);
+}
+
+/* Open the font from the path it was last resolved to, avoiding a fontconfig
+ * match. */
+static struct wld_font *
+open_cached_font(const char *cache)
+{
+	FILE *file;
+	char name[256], path[PATH_MAX];
+	double size;
+	FcPattern *pattern;
+	struct wld_font *font = NULL;
+
+	if (!(file = fopen(cache, "r")))
+		return NULL;
+
+	if (!fgets(name, sizeof(name), file) || !fgets(path, sizeof(path), file)
+	    || fscanf(file, "%lf", &size) != 1) {
+		goto done;
 	}
 
-	x = start_x[ALIGN_RIGHT];
-	wl_list_for_each (item, &bar->items[ALIGN_RIGHT], link) {
-		item->interface->draw(bar, item, x, 0);
-		x += item->data->width;
+	name[strcspn(name, "\n")] = '\0';
+	path[strcspn(path, "\n")] = '\0';
+	if (strcmp(name, font_name) != 0 || access(path, R_OK) != 0)
+		goto done;
+
+	if (!(pattern = FcPatternCreate()))
+		goto done;
+	FcPatternAddString(pattern, FC_FILE, (const FcChar8 *)path);
+	FcPatternAddDouble(pattern, FC_PIXEL_SIZE, size);
+	font = wld_font_open_pattern(wld.font_context, pattern);
+	FcPatternDestroy(pattern);
+
+done:
+	fclose(file);
+	return font;
+}
+
+static void
+write_font_cache(const char *cache, const char *dir, FcPattern *match)
+{
+	FcChar8 *path;
+	double size;
+	char temp[PATH_MAX];
+	FILE *file;
+	int ret;
+
+	if (FcPatternGetString(match, FC_FILE, 0, &path) != FcResultMatch
+	    || FcPatternGetDouble(match, FC_PIXEL_SIZE, 0, &size) != FcResultMatch) {
+		return;
 	}
 
-	wl_surface_damage(bar->surface, 0, 0, bar->width, bar->height);
-	wld_flush(wld.renderer);
-	wld_swap(bar->wld_surface);
+	ret = snprintf(temp, sizeof(temp), "%s.tmp", cache);
+	if (ret < 0 || ret >= sizeof(temp))
+		return;
+
+	mkdir(dir, 0755);
+	if (!(file = fopen(temp, "w")))
+		return;
+	fprintf(file, "%s\n%s\n%g\n", font_name, (const char *)path, size);
+	if (fclose(file) != 0 || rename(temp, cache) != 0)
+		unlink(temp);
+}
+
+static struct wld_font *
+open_font(bool *cached)
+{
+	char dir[PATH_MAX], cache[PATH_MAX];
+	const char *base;
+	FcPattern *pattern, *match;
+	FcResult result;
+	struct wld_font *font;
+	int ret;
+
+	if ((base = getenv("XDG_CACHE_HOME")))
+		ret = snprintf(dir, sizeof(dir), "%s/velox", base);
+	else if ((base = getenv("HOME")))
+		ret = snprintf(dir, sizeof(dir), "%s/.cache/velox", base);
+	else
+		ret = -1;
+
+	if (ret < 0 || ret >= sizeof(dir))
+		dir[0] = cache[0] = '\0';
+	else if ((ret = snprintf(cache, sizeof(cache), "%s/status_bar_font", dir)) < 0 || ret >= sizeof(cache))
+		cache[0] = '\0';
+
+	if (cache[0] && (font = open_cached_font(cache))) {
+		*cached = true;
+		return font;
+	}
+
+	*cached = false;
+	if (!(pattern = FcNameParse((const FcChar8 *)font_name)))
+		return NULL;
+	FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+	FcDefaultSubstitute(pattern);
+	match = FcFontMatch(NULL, pattern, &result);
+	FcPatternDestroy(pattern);
+	if (!match)
+		return NULL;
+
+	if ((font = wld_font_open_pattern(wld.font_context, match)) && cache[0])
+		write_font_cache(cache, dir, match);
+	FcPatternDestroy(match);
+
+	return font;
 }
 
 static void
@@ -408,14 +618,18 @@ setup(void)
 	struct tag *tag;
 	struct wl_list *items;
 	struct item *item;
-
-	fprintf(stderr, "status bar: Initializing...");
+	bool cached;
 
 	wl_list_init(&screens);
 	wl_list_init(&tags);
+	wl_list_init(&watches);
+	wl_list_init(&groups);
 
-	if (timer_create(CLOCK_MONOTONIC, NULL, &timer) != 0)
+	clock_watch.fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+	if (clock_watch.fd == -1)
 		die("Failed to create timer: %s", strerror(errno));
+	clock_watch.handle = &handle_clock;
+	watch_add(&clock_watch);
 
 	if (!(display = wl_display_connect(NULL)))
 		die("Failed to connect to display");
@@ -424,9 +638,21 @@ setup(void)
 		die("Failed to get registry");
 
 	wl_registry_add_listener(registry, &registry_listener, NULL);
+	wl_display_flush(display);
+	log_phase("connected");
+
+	/* Open the font while the compositor sends the globals. It is needed before
+	 * any tag events are handled. */
+	wld.font_context = wld_font_create_context();
+	if (!wld.font_context)
+		die("Failed to create WLD font context");
+	if (!(wld.font = open_font(&cached)))
+		die("Failed to open font");
+	log_phase(cached ? "opened cached font" : "opened font");
 
 	/* Wait for globals. */
 	wl_display_roundtrip(display);
+	log_phase("received globals");
 
 	if (!compositor || !panel_manager || !velox) {
 		die("Missing required globals: wl_compositor, swc_panel_manager, velox");
@@ -440,15 +666,11 @@ setup(void)
 	if (!wld.renderer)
 		die("Failed to create WLD renderer");
 
-	/* Font */
-	wld.font_context = wld_font_create_context();
-	if (!wld.font_context)
-		die("Failed to create WLD font context");
-	wld.font = wld_font_open_name(wld.font_context, font_name);
-	if (!wld.font)
-		die("Failed to open font");
+	sources_initialize();
+	external_initialize();
 
-	/* Create the panels */
+	/* Create the panels. They are drawn as soon as they are docked, so we
+	 * don't wait for that here. */
 	wl_list_for_each (screen, &screens, link) {
 		screen->velox = velox_get_screen(velox, screen->swc);
 		if (!screen->velox)
@@ -456,6 +678,11 @@ setup(void)
 		velox_screen_add_listener(screen->velox, &velox_screen_listener, screen);
 
 		status_bar = &screen->status_bar;
+		status_bar->frame = NULL;
+		status_bar->dirty = false;
+		pixman_region32_init(&status_bar->pending);
+		status_bar->group = NULL;
+		status_bar->wld_surface = NULL;
 		status_bar->surface = wl_compositor_create_surface(compositor);
 		status_bar->panel = swc_panel_manager_create_panel(panel_manager, status_bar->surface);
 		swc_panel_add_listener(status_bar->panel, &panel_listener, status_bar);
@@ -476,60 +703,49 @@ setup(void)
 		wl_list_insert(items->prev, &item->link);
 
 		/* Window title */
-		item = item_new(&text_interface, &screen->focus_data.base);
+		item = item_new(&title_interface, &screen->focus_data.base.base);
 		wl_list_insert(items->prev, &item->link);
 
 		items = &screen->status_bar.items[ALIGN_CENTER];
 		wl_list_init(items);
-
-		items = &screen->status_bar.items[ALIGN_RIGHT];
-		wl_list_init(items);
-
-		/* Clock */
-		item = item_new(&text_interface, &clock_data.base);
-		wl_list_insert(items, &item->link);
-	}
-
-	/* Wait for dock notifications. */
-	wl_display_roundtrip(display);
-
-	wl_list_for_each (screen, &screens, link) {
-		if (!screen->status_bar.wld_surface)
-			die("");
-		swc_panel_set_strut(screen->status_bar.panel, screen->status_bar.height, 0, screen->status_bar.width);
 	}
 
-	fprintf(stderr, "done\n");
-
 	wl_display_flush(display);
+	log_phase("requested panels");
 }
 
 static void
 run(void)
 {
-	sigset_t signals;
-	struct itimerspec timer_value = {
-		.it_interval = { 1, 0 },
-		.it_value = { 0, 1 }
-	};
-	struct pollfd fds[2];
 	struct screen *screen;
-
-	sigemptyset(&signals);
-	sigaddset(&signals, SIGALRM);
-	sigprocmask(SIG_BLOCK, &signals, NULL);
-
-	fds[0].fd = wl_display_get_fd(display);
-	fds[0].events = POLLIN;
-	fds[1].fd = signalfd(-1, &signals, SFD_CLOEXEC);
-	fds[1].events = POLLIN;
-
-	timer_settime(timer, 0, &timer_value, NULL);
+	struct status_bar *bar;
+	struct group *group;
+	struct watch *watch;
+	unsigned index, num_fds;
+	uint64_t now, latency;
+
+	update_clock();
+	schedule_clock();
 	running = true;
 
 	while (true) {
-		if (poll(fds, sizeof(fds) / sizeof(fds[0]), -1) == -1)
+		struct pollfd fds[1 + wl_list_length(&watches)];
+		struct watch *polled[ARRAY_LENGTH(fds)];
+
+		fds[0].fd = wl_display_get_fd(display);
+		fds[0].events = POLLIN;
+		num_fds = 1;
+		wl_list_for_each (watch, &watches, link) {
+			fds[num_fds].fd = watch->fd;
+			fds[num_fds].events = POLLIN;
+			polled[num_fds++] = watch;
+		}
+
+		if (poll(fds, num_fds, -1) == -1) {
+			if (errno == EINTR)
+				continue;
 			break;
+		}
 
 		if (fds[0].revents & POLLIN) {
 			if (wl_display_dispatch(display) == -1) {
@@ -538,22 +754,48 @@ run(void)
 				break;
 			}
 		}
-		if (fds[1].revents & POLLIN) {
-			time_t raw_time = time(NULL);
-			struct tm *local_time = localtime(&raw_time);
 
-			sigwaitinfo(&signals, NULL);
-
-			strftime(clock_text, sizeof(clock_text), "%A %T %F", local_time);
-			update_text_item_data(&clock_data);
+		/* Handlers may only remove their own watch. */
+		for (index = 1; index < num_fds; ++index) {
+			if (fds[index].revents & (POLLIN | POLLHUP | POLLERR))
+				polled[index]->handle(polled[index]);
 		}
 
 		if (need_draw) {
-			wl_list_for_each (screen, &screens, link)
-				draw(&screen->status_bar);
+			now = get_time();
+			wl_list_for_each (group, &groups, link)
+				group_draw(group);
+			wl_list_for_each (screen, &screens, link) {
+				bar = &screen->status_bar;
+				/* Not docked yet. */
+				if (!bar->group)
+					continue;
+				pixman_region32_union(&bar->pending, &bar->pending, &bar->group->damage);
+				if (bar->dirty)
+					continue;
+				bar->dirty = true;
+				bar->dirty_time = now;
+				if (bar->frame)
+					++draw_stats.deferred;
+			}
 			need_draw = false;
 		}
 
+		/* Draw the bars whose last frame has been presented. */
+		wl_list_for_each (screen, &screens, link) {
+			bar = &screen->status_bar;
+			if (!bar->dirty || bar->frame)
+				continue;
+			draw(bar);
+			bar->dirty = false;
+
+			latency = get_time() - bar->dirty_time;
+			++draw_stats.draws;
+			draw_stats.latency_total += latency;
+			if (latency > draw_stats.latency_max)
+				draw_stats.latency_max = latency;
+		}
+
 		wl_display_flush(display);
 	}
 }
@@ -561,8 +803,15 @@ run(void)
 int
 main(int argc, char *argv[])
 {
+	start_time = get_time();
 	setup();
 	run();
 
+	print_text_cache_statistics();
+	fprintf(stderr, "status bar: %lu draws, %lu deferred until frame callback; latency %llu us average, %llu us max\n",
+	        draw_stats.draws, draw_stats.deferred,
+	        (unsigned long long)(draw_stats.draws ? draw_stats.latency_total / draw_stats.draws : 0),
+	        (unsigned long long)draw_stats.latency_max);
+
 	return EXIT_SUCCESS;
 }
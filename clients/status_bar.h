@@ -0,0 +1,215 @@
+/* velox: clients/status_bar.h
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_CLIENTS_STATUS_BAR_H
+#define VELOX_CLIENTS_STATUS_BAR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pixman.h>
+#include <wayland-util.h>
+
+#define ARRAY_LENGTH(array) (sizeof array / sizeof array[0])
+
+struct swc_panel;
+struct status_bar;
+struct swc_screen;
+struct velox_screen;
+struct velox_tag;
+struct wl_callback;
+struct wl_surface;
+struct wld_buffer;
+struct wld_surface;
+
+struct item {
+	const struct item_interface *interface;
+	const struct item_data *data;
+	struct wl_list link;
+
+	/* The position, width and data serial when the item was last drawn. */
+	uint32_t x, width;
+	unsigned serial;
+};
+
+struct item_data {
+	uint32_t width;
+	/* Incremented whenever the appearance of items using this data changes. */
+	unsigned serial;
+};
+
+struct text_item_data {
+	struct item_data base;
+	const char *text;
+};
+
+/* A window title, which is cut short with an ellipsis if it does not fit in
+ * the available width. */
+struct title_item_data {
+	struct text_item_data base;
+
+	/* The byte offset and total advance at each character boundary. */
+	struct title_boundary {
+		size_t offset;
+		uint32_t advance;
+	} *boundaries;
+	size_t num_boundaries;
+
+	/* The width available, or 0 if there is no limit, and the number of bytes
+	 * shown before the ellipsis if the title does not fit. */
+	uint32_t max_width;
+	size_t length;
+	bool elided;
+};
+
+struct item_interface {
+	void (*draw)(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
+};
+
+enum align {
+	ALIGN_LEFT,
+	ALIGN_CENTER,
+	ALIGN_RIGHT,
+};
+
+struct style {
+	uint32_t fg, bg;
+};
+
+struct status_bar {
+	struct wl_surface *surface;
+	struct swc_panel *panel;
+
+	struct wld_surface *wld_surface;
+	uint32_t width, height;
+	bool damaged;
+
+	/* The frame callback for the last commit, or NULL if it has been
+	 * presented. Only one frame is drawn at a time, so changes made while it
+	 * is pending accumulate until it arrives. */
+	struct wl_callback *frame;
+	bool dirty;
+	uint64_t dirty_time;
+	/* Damage to the group canvas not yet copied to this bar. */
+	pixman_region32_t pending;
+
+	/* Right-aligned items are the same on every screen, so they belong to the
+	 * group instead. */
+	struct wl_list items[ALIGN_RIGHT];
+	struct group *group;
+	struct wl_list group_link;
+};
+
+/* Bars of the same size, which share the rendering of their right-aligned
+ * items. These are drawn once into the canvas, and copied to each bar. */
+struct group {
+	uint32_t width, height;
+	struct wld_buffer *canvas;
+	bool damaged;
+
+	struct wl_list items;
+	/* The start of the right-aligned items, and the area of the canvas
+	 * redrawn in the last update. */
+	uint32_t x;
+	pixman_region32_t damage;
+
+	struct wl_list bars;
+	struct wl_list link;
+};
+
+struct tag {
+	struct velox_tag *velox;
+	struct velox_screen *screen;
+	struct wl_list link;
+
+	struct text_item_data name_data;
+	char *name;
+	unsigned num_windows;
+};
+
+struct screen {
+	struct swc_screen *swc;
+	struct velox_screen *velox;
+	struct status_bar status_bar;
+	struct wl_list link;
+
+	struct title_item_data focus_data;
+	struct {
+		char *title;
+		struct velox_tag *tag;
+	} focus;
+};
+
+struct wld {
+	struct wld_context *context;
+	struct wld_renderer *renderer;
+	struct wld_font_context *font_context;
+	struct wld_font *font;
+};
+
+/* A file descriptor polled by the main loop. */
+struct watch {
+	int fd;
+	void (*handle)(struct watch *watch);
+	struct wl_list link;
+};
+
+void __attribute__((noreturn)) die(const char *const format, ...);
+void *xmalloc(size_t size);
+
+/* Drawing */
+extern struct wld wld;
+/* Set whenever an item changes. */
+extern bool need_draw;
+/* The number of pixels filled or copied so far. */
+extern uint64_t pixels_drawn;
+extern const struct style normal, selected;
+extern const struct item_interface text_interface, title_interface, tag_interface, divider_interface;
+
+struct item *item_new(const struct item_interface *interface, const struct item_data *data);
+void item_data_changed(struct item_data *data);
+void update_text_item_data(struct text_item_data *data);
+void update_title_item_data(struct title_item_data *data);
+void text_draw(struct status_bar *status_bar, struct item *item, uint32_t x, uint32_t y);
+
+struct group *group_new(uint32_t width, uint32_t height);
+void group_destroy(struct group *group);
+void group_draw(struct group *group);
+bool bar_draw(struct status_bar *bar, pixman_region32_t *damage);
+void print_text_cache_statistics(void);
+
+void watch_add(struct watch *watch);
+void watch_remove(struct watch *watch);
+
+/* Whether any bar has presented its last frame. */
+bool bars_visible(void);
+
+/* Status sources */
+void sources_initialize(void);
+void sources_add_items(struct wl_list *items);
+void sources_resume(void);
+
+/* External status input */
+void external_initialize(void);
+void external_add_items(struct wl_list *items);
+
+#endif
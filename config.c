@@ -23,7 +23,14 @@
  */
 
 #include "config.h"
+#include "intern.h"
+#include "latency.h"
+#include "pool.h"
+#include "record.h"
+#include "stats.h"
+#include "trace.h"
 #include "util.h"
+#include "watchdog.h"
 #include "velox.h"
 
 #include <fcntl.h>
@@ -78,6 +85,14 @@ tap_to_click_set(struct config_node *node, const char *value)
 static CONFIG_PROPERTY(mod, &mod_set);
 static CONFIG_PROPERTY(tap_to_click, &tap_to_click_set);
 
+static bool
+watchdog_threshold_set(struct config_node *node, const char *value)
+{
+	return config_set_unsigned(&watchdog_threshold, value, 10);
+}
+
+static CONFIG_PROPERTY(watchdog_threshold, &watchdog_threshold_set);
+
 static bool
 section_match(const char *p, const char *q)
 {
@@ -146,9 +161,11 @@ handle_set(char *s)
 
 struct spawn_action {
 	struct config_node node;
-	char *command;
+	const char *command;
 };
 
+static struct pool spawn_action_pool = POOL_INITIALIZER(struct spawn_action, 16);
+
 static void
 spawn(struct config_node *node, const struct variant *v)
 {
@@ -165,7 +182,8 @@ spawn(struct config_node *node, const struct variant *v)
 		goto destroy;
 	if (posix_spawn_file_actions_adddup2(&file_actions, 0, 2))
 		goto destroy;
-	posix_spawn(&pid, "/bin/sh", &file_actions, NULL, (char *[]){"sh", "-c", action->command, NULL}, environ);
+	posix_spawn(&pid, "/bin/sh", &file_actions, NULL, (char *[]){"sh", "-c", (char *)action->command, NULL}, environ);
+	++stats[STAT_SPAWNS];
 destroy:
 	posix_spawn_file_actions_destroy(&file_actions);
 }
@@ -175,26 +193,35 @@ spawn_action(char *command)
 {
 	struct spawn_action *action;
 
-	if (!(action = malloc(sizeof(*action))))
+	if (!(action = pool_get(&spawn_action_pool)))
 		goto error0;
 
 	action->node.action.run = &spawn;
-	if (!(action->command = strdup(command)))
+	if (!(action->command = intern(command)))
 		goto error1;
 
 	return &action->node;
 
 error1:
-	free(action);
+	pool_put(&spawn_action_pool, action);
 error0:
 	return NULL;
 }
 
+static void
+destroy_spawn_action(struct config_node *node)
+{
+	struct spawn_action *action = wl_container_of(node, action, node);
+
+	pool_put(&spawn_action_pool, action);
+}
+
 static const struct {
 	const char *name;
 	struct config_node *(*create_action)(char *arguments);
+	void (*destroy_action)(struct config_node *node);
 } action_types[] = {
-	{ "spawn", &spawn_action }
+	{ "spawn", &spawn_action, &destroy_spawn_action }
 };
 
 static bool
@@ -237,7 +264,7 @@ handle_action(char *s)
 				goto error0;
 			}
 
-			if (!(node->name = strdup(name)))
+			if (!(node->name = intern(name)))
 				goto error1;
 			node->type = CONFIG_NODE_TYPE_ACTION;
 			wl_list_insert(&group_node->group, &node->link);
@@ -247,24 +274,51 @@ handle_action(char *s)
 	return true;
 
 error1:
-	free(node);
+	action_types[index].destroy_action(node);
 error0:
 	return false;
 }
 
+void
+config_run(struct config_node *node, const struct variant *v)
+{
+	TRACE_BEGIN(node->name);
+	watchdog_begin(node->name);
+	node->action.run(node, v);
+	watchdog_end();
+	TRACE_END(node->name);
+}
+
 struct binding {
+	enum swc_binding_type type;
+	uint32_t mods, value;
 	struct config_node *press, *release;
+	/* The action identifiers as written, such as tag.1.activate, naming the
+	 * latency histograms. Interned, see intern.h. */
+	const char *press_name, *release_name;
 };
 
+static struct pool binding_pool = POOL_INITIALIZER(struct binding, 64);
+static struct pool rule_pool = POOL_INITIALIZER(struct rule, 16);
+
+static void
+run_binding(struct config_node *node, const char *name)
+{
+	latency_begin();
+	config_run(node, NULL);
+	latency_end(name);
+}
+
 static void
 key_binding(void *data, uint32_t time, uint32_t value, uint32_t state)
 {
 	struct binding *binding = data;
 
+	record_binding(binding->type, binding->mods, binding->value, state);
 	if (state == WL_KEYBOARD_KEY_STATE_PRESSED && binding->press)
-		binding->press->action.run(binding->press, NULL);
+		run_binding(binding->press, binding->press_name);
 	else if (binding->release)
-		binding->release->action.run(binding->release, NULL);
+		run_binding(binding->release, binding->release_name);
 }
 
 static void
@@ -272,10 +326,11 @@ button_binding(void *data, uint32_t time, uint32_t value, uint32_t state)
 {
 	struct binding *binding = data;
 
+	record_binding(binding->type, binding->mods, binding->value, state);
 	if (state == WL_POINTER_BUTTON_STATE_PRESSED && binding->press)
-		binding->press->action.run(binding->press, NULL);
+		run_binding(binding->press, binding->press_name);
 	else if (binding->release)
-		binding->release->action.run(binding->release, NULL);
+		run_binding(binding->release, binding->release_name);
 }
 
 static void (*binding_handler[])(void *, uint32_t, uint32_t, uint32_t) = {
@@ -321,13 +376,17 @@ static bool (*parse_value[])(char *, uint32_t *) = {
 };
 
 static bool
-parse_action(char *s, struct config_node **node)
+parse_action(char *s, struct config_node **node, const char **name)
 {
 	if (*s == '\0') {
 		*node = NULL;
+		*name = NULL;
 		return true;
 	}
 
+	if (!(*name = intern(s)))
+		return false;
+
 	return (*node = lookup(s)) && (*node)->type == CONFIG_NODE_TYPE_ACTION;
 }
 
@@ -338,22 +397,22 @@ handle_binding(enum swc_binding_type type, char *s)
 	uint32_t value, mod, mods;
 	struct binding *binding;
 
-	if (!(binding = malloc(sizeof(*binding)))) {
+	if (!(binding = pool_get(&binding_pool))) {
 		fprintf(stderr, "Failed to allocate binding\n");
 		return false;
 	}
 
 	if (!(value_string = strtok_r(s, whitespace, &s))) {
 		fprintf(stderr, "No key specified\n");
-		return false;
+		goto error;
 	}
 
 	if (!parse_value[type](value_string, &value))
-		return false;
+		goto error;
 
 	if (!(mods_string = strtok_r(NULL, whitespace, &s))) {
 		fprintf(stderr, "No modifiers specified\n");
-		return false;
+		goto error;
 	}
 
 	mods = 0;
@@ -362,7 +421,7 @@ handle_binding(enum swc_binding_type type, char *s)
 	     mod_string = strtok_r(NULL, ",", &mods_string)) {
 		if (!parse_modifier(mod_string, &mod)) {
 			fprintf(stderr, "Invalid modifier '%s'\n", mod_string);
-			return false;
+			goto error;
 		}
 
 		mods |= mod;
@@ -370,7 +429,7 @@ handle_binding(enum swc_binding_type type, char *s)
 
 	if (!(actions_string = strtok_r(NULL, whitespace, &s))) {
 		fprintf(stderr, "No action specified\n");
-		return false;
+		goto error;
 	}
 
 	action_identifier = actions_string;
@@ -380,22 +439,29 @@ handle_binding(enum swc_binding_type type, char *s)
 		*actions_string++ = '\0';
 
 	/* Lookup press action (if present) */
-	if (!parse_action(action_identifier, &binding->press)) {
+	if (!parse_action(action_identifier, &binding->press, &binding->press_name)) {
 		fprintf(stderr, "Could not find action '%s'\n", action_identifier);
-		return false;
+		goto error;
 	}
 
 	action_identifier = actions_string;
 
 	/* Lookup release action (if present) */
-	if (!parse_action(action_identifier, &binding->release)) {
+	if (!parse_action(action_identifier, &binding->release, &binding->release_name)) {
 		fprintf(stderr, "Could not find action '%s'\n", action_identifier);
-		return false;
+		goto error;
 	}
 
+	binding->type = type;
+	binding->mods = mods;
+	binding->value = value;
 	swc_add_binding(type, mods, value, binding_handler[type], binding);
 
 	return true;
+
+error:
+	pool_put(&binding_pool, binding);
+	return false;
 }
 
 static bool
@@ -454,7 +520,7 @@ handle_rule(char *s)
 		goto error0;
 	}
 
-	if (!(rule = malloc(sizeof(*rule))))
+	if (!(rule = pool_get(&rule_pool)))
 		goto error0;
 
 	if (strcmp(type, "title") == 0) {
@@ -466,9 +532,8 @@ handle_rule(char *s)
 		goto error1;
 	}
 
-	if (!(rule->identifier = strdup(identifier))) {
+	if (!(rule->identifier = intern(identifier)))
 		goto error1;
-	}
 
 	rule->action = action;
 	wl_list_insert(&velox.rules, &rule->link);
@@ -476,7 +541,7 @@ handle_rule(char *s)
 	return true;
 
 error1:
-	free(rule);
+	pool_put(&rule_pool, rule);
 error0:
 	return false;
 }
@@ -545,6 +610,7 @@ config_parse(void)
 
 	wl_list_insert(&root_group.group, &mod_property.link);
 	wl_list_insert(&root_group.group, &tap_to_click_property.link);
+	wl_list_insert(&root_group.group, &watchdog_threshold_property.link);
 
 	if (!(file = open_config()))
 		goto error0;
@@ -79,6 +79,7 @@ struct config_node {
 	}
 
 bool config_parse(void);
+void config_run(struct config_node *node, const struct variant *v);
 bool config_set_unsigned(unsigned *value, const char *string, int base);
 
 extern struct wl_list *config_root;
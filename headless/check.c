@@ -0,0 +1,192 @@
+/* velox: headless/check.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "headless.h"
+#include "layout.h"
+#include "screen.h"
+#include "stats.h"
+#include "velox.h"
+#include "window.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+struct query {
+	struct screen *screen;
+	/* The number of times each entry of the screen was reported. */
+	unsigned *reported;
+	bool ok;
+};
+
+static bool
+intersects(const struct swc_rectangle *a, const struct swc_rectangle *b)
+{
+	return (int64_t)a->x < (int64_t)b->x + b->width && (int64_t)b->x < (int64_t)a->x + a->width
+	    && (int64_t)a->y < (int64_t)b->y + b->height && (int64_t)b->y < (int64_t)a->y + a->height;
+}
+
+static bool
+equal(const struct swc_rectangle *a, const struct swc_rectangle *b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+static void
+report(const struct spatial_item *item, void *data)
+{
+	struct query *query = data;
+	unsigned id = headless_window_id(item->window->swc);
+	struct window_entry *entry;
+
+	if (item->window->array != &query->screen->windows) {
+		fprintf(stderr, "headless: window %u is indexed on screen %u, but isn't shown there\n",
+		        id, query->screen->id);
+		query->ok = false;
+		return;
+	}
+
+	entry = window_entry(item->window);
+	if (entry->layer != STACK || !equal(&item->geometry, &entry->geometry)) {
+		fprintf(stderr, "headless: window %u is indexed at %d %d %u %u, but isn't floating there\n",
+		        id, item->geometry.x, item->geometry.y, item->geometry.width, item->geometry.height);
+		query->ok = false;
+		return;
+	}
+
+	++query->reported[item->window->index];
+}
+
+/* Every floating window intersecting the rectangle must be reported exactly
+ * once, and no other window. */
+static bool
+check_query(struct query *query, const struct swc_rectangle *rectangle)
+{
+	struct screen *screen = query->screen;
+	struct window_entry *entry;
+	unsigned expected;
+
+	memset(query->reported, 0, window_count(&screen->windows) * sizeof(*query->reported));
+	spatial_query(&screen->floating, rectangle, &report, query);
+
+	wl_array_for_each (entry, &screen->windows) {
+		expected = entry->layer == STACK && intersects(&entry->geometry, rectangle);
+		if (query->reported[entry->window->index] != expected) {
+			fprintf(stderr, "headless: window %u was reported %u times for %d %d %u %u, expected %u\n",
+			        headless_window_id(entry->window->swc), query->reported[entry->window->index],
+			        rectangle->x, rectangle->y, rectangle->width, rectangle->height, expected);
+			query->ok = false;
+		}
+	}
+
+	return query->ok;
+}
+
+static bool
+check_screen(struct screen *screen)
+{
+	const struct swc_rectangle *area = &screen->swc->usable_geometry, *shown;
+	struct query query = { .screen = screen, .ok = true };
+	struct window_entry *entry;
+	struct swc_rectangle corner = { .width = 1, .height = 1 }, probe, strips[4];
+	struct window *window;
+	int64_t x, y, half = SPATIAL_CELL_SIZE / 2;
+	unsigned id, index;
+
+	if (!(query.reported = calloc(window_count(&screen->windows) + 1, sizeof(*query.reported)))) {
+		fprintf(stderr, "headless: could not check the spatial index\n");
+		return false;
+	}
+
+	/* Every cell of the grid, so that windows reaching into a cell from
+	 * another one are looked for from that cell, and the same squares moved by
+	 * half a cell. */
+	check_query(&query, area);
+	probe.width = probe.height = SPATIAL_CELL_SIZE;
+	for (y = (int64_t)area->y - half; y < (int64_t)area->y + area->height; y += half) {
+		for (x = (int64_t)area->x - half; x < (int64_t)area->x + area->width; x += half) {
+			probe.x = x;
+			probe.y = y;
+			check_query(&query, &probe);
+		}
+	}
+
+	wl_array_for_each (entry, &screen->windows) {
+		if (entry->layer != STACK || entry->geometry.width == 0 || entry->geometry.height == 0)
+			continue;
+
+		id = headless_window_id(entry->window->swc);
+		shown = headless_window_geometry(entry->window->swc);
+		if (!equal(&entry->geometry, shown)) {
+			fprintf(stderr, "headless: window %u is indexed at %d %d %u %u, but swc has %d %d %u %u\n",
+			        id, entry->geometry.x, entry->geometry.y, entry->geometry.width, entry->geometry.height,
+			        shown->x, shown->y, shown->width, shown->height);
+			query.ok = false;
+		}
+
+		corner.x = entry->geometry.x;
+		corner.y = entry->geometry.y;
+		window = spatial_at(&screen->floating, corner.x, corner.y);
+		if (!window || window->array != &screen->windows || !intersects(&window_entry(window)->geometry, &corner)) {
+			fprintf(stderr, "headless: no window found at the top-left corner of window %u\n", id);
+			query.ok = false;
+		}
+
+		/* The window itself, and the strips between it and each edge of the
+		 * screen, which are what moves search. */
+		for (index = 0; index < 4; ++index)
+			strips[index] = entry->geometry;
+		strips[0].x = area->x;
+		strips[0].width = MAX((int64_t)entry->geometry.x - area->x, 0);
+		strips[1].x = entry->geometry.x + entry->geometry.width;
+		strips[1].width = MAX((int64_t)area->x + area->width - strips[1].x, 0);
+		strips[2].y = area->y;
+		strips[2].height = MAX((int64_t)entry->geometry.y - area->y, 0);
+		strips[3].y = entry->geometry.y + entry->geometry.height;
+		strips[3].height = MAX((int64_t)area->y + area->height - strips[3].y, 0);
+
+		check_query(&query, &entry->geometry);
+		for (index = 0; index < 4; ++index)
+			check_query(&query, &strips[index]);
+	}
+
+	free(query.reported);
+	return query.ok;
+}
+
+bool
+headless_check_spatial(void)
+{
+	uint64_t saved[NUM_STATS];
+	struct screen *screen;
+	bool ok = true;
+
+	/* The queries made here aren't velox's work. */
+	memcpy(saved, stats, sizeof(saved));
+	wl_list_for_each (screen, &velox.screens, link)
+		ok = check_screen(screen) && ok;
+	memcpy(stats, saved, sizeof(saved));
+
+	return ok;
+}
@@ -0,0 +1,138 @@
+/* velox: headless/clients.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "headless.h"
+#include "screen.h"
+#include "tag.h"
+#include "velox.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+/* In-process clients, connected over socket pairs, that bind velox objects
+ * directly on the server side and discard every event sent to them. */
+struct connection {
+	struct wl_client *client;
+	struct wl_listener destroy_listener;
+	int fd;
+	struct wl_list link;
+};
+
+/* Most recently connected first. */
+static struct wl_list connections = { &connections, &connections };
+
+static void
+handle_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct connection *connection = wl_container_of(listener, connection, destroy_listener);
+
+	wl_list_remove(&connection->link);
+	close(connection->fd);
+	free(connection);
+}
+
+static bool
+connect_client(void)
+{
+	struct connection *connection;
+	struct screen *screen;
+	unsigned index;
+	uint32_t id;
+	int fds[2];
+
+	if (!(connection = malloc(sizeof(*connection))))
+		goto error0;
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+		goto error1;
+	/* Depending on how far it got, wl_client_create may already have closed
+	 * the server end when it fails. */
+	if (!(connection->client = wl_client_create(velox.display, fds[0])))
+		goto error2;
+
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	connection->fd = fds[1];
+	connection->destroy_listener.notify = &handle_client_destroy;
+	wl_client_add_destroy_listener(connection->client, &connection->destroy_listener);
+	wl_list_insert(&connections, &connection->link);
+
+	/* Object 1 is the wl_display. */
+	id = 2;
+	for (index = 0; index < NUM_TAGS; ++index) {
+		if (!tag_bind(velox.tags[index], connection->client, 1, id++))
+			return false;
+	}
+	wl_list_for_each (screen, &velox.screens, link) {
+		if (!screen_bind(screen, connection->client, id++))
+			return false;
+	}
+
+	return true;
+
+error2:
+	close(fds[1]);
+error1:
+	free(connection);
+error0:
+	return false;
+}
+
+bool
+headless_connect(unsigned count)
+{
+	while (count-- > 0) {
+		if (!connect_client())
+			return false;
+	}
+
+	return true;
+}
+
+void
+headless_disconnect(unsigned count)
+{
+	struct connection *connection;
+
+	while (count-- > 0 && !wl_list_empty(&connections)) {
+		connection = wl_container_of(connections.next, connection, link);
+		wl_client_destroy(connection->client);
+	}
+}
+
+void
+headless_drain(void)
+{
+	struct connection *connection;
+	char buffer[4096];
+
+	if (wl_list_empty(&connections))
+		return;
+
+	wl_display_flush_clients(velox.display);
+	wl_list_for_each (connection, &connections, link) {
+		while (read(connection->fd, buffer, sizeof(buffer)) > 0)
+			;
+	}
+}
@@ -0,0 +1,63 @@
+/* velox: headless/headless.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_HEADLESS_H
+#define VELOX_HEADLESS_H
+
+#include "swc.h"
+
+struct wl_event_loop;
+
+/* Events injected into velox through the headless swc. Screens and windows are
+ * named by the caller, and window 0 means no window. */
+void headless_new_screen(unsigned id, const struct swc_rectangle *geometry, const struct swc_rectangle *usable_geometry);
+void headless_set_usable_geometry(unsigned id, const struct swc_rectangle *geometry);
+void headless_new_window(unsigned id, const char *app_id, const char *title);
+void headless_set_title(unsigned id, const char *title);
+void headless_set_parent(unsigned id, unsigned parent);
+void headless_enter(unsigned id);
+void headless_destroy(unsigned id);
+void headless_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t value, uint32_t state);
+
+/* Connect clients that bind every velox_tag and velox_screen, or disconnect
+ * the most recently connected ones. headless_drain flushes events to them and
+ * throws them away. */
+bool headless_connect(unsigned count);
+void headless_disconnect(unsigned count);
+void headless_drain(void);
+
+/* The id a window was created with, and the geometry velox last gave it. */
+unsigned headless_window_id(struct swc_window *window);
+const struct swc_rectangle *headless_window_geometry(struct swc_window *window);
+
+/* Check the spatial index of every screen against a linear scan of its
+ * windows, reporting any difference to standard error. */
+bool headless_check_spatial(void);
+
+/* The number of calls velox has made into swc. */
+uint64_t headless_calls(void);
+void headless_quit(void);
+
+bool replay_start(struct wl_event_loop *event_loop, const char *path);
+
+#endif
@@ -0,0 +1,49 @@
+/* velox: headless/libinput.h
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The headless swc never reports input devices, so only enough of libinput to
+ * compile velox.c is provided. */
+
+#ifndef LIBINPUT_H
+#define LIBINPUT_H
+
+struct libinput_device;
+
+enum libinput_config_status {
+	LIBINPUT_CONFIG_STATUS_SUCCESS,
+	LIBINPUT_CONFIG_STATUS_UNSUPPORTED,
+	LIBINPUT_CONFIG_STATUS_INVALID,
+};
+
+enum libinput_config_tap_state {
+	LIBINPUT_CONFIG_TAP_DISABLED,
+	LIBINPUT_CONFIG_TAP_ENABLED,
+};
+
+static inline enum libinput_config_status
+libinput_device_config_tap_set_enabled(struct libinput_device *device, enum libinput_config_tap_state enable)
+{
+	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,64 @@
+# velox: headless/local.mk
+
+dir := headless
+
+$(dir)_PACKAGES := wayland-server xkbcommon
+
+# The velox core, built against the headless swc in this directory instead of
+# the real one.
+HEADLESS_SOURCES := $(filter-out protocol/%,$(VELOX_SOURCES))
+HEADLESS_OBJECTS :=                                 \
+    $(HEADLESS_SOURCES:%.c=$(dir)/core/%.o)         \
+    $(dir)/check.o                                  \
+    $(dir)/clients.o                                \
+    $(dir)/replay.o                                 \
+    $(dir)/swc.o                                    \
+    protocol/velox-protocol.o
+
+CLEAN_FILES += $(HEADLESS_OBJECTS) $(dir)/velox $(dir)/home/.velox.conf
+
+.deps/$(dir)/core: | .deps/$(dir)
+	@mkdir "$@"
+
+$(dir)/core:
+	@mkdir "$@"
+
+$(dir)/core/%.o: %.c | .deps/$(dir)/core $(dir)/core
+	$(call quiet,CC) $(FINAL_CPPFLAGS) $(FINAL_CFLAGS) -c -o $@ $< \
+	    -MMD -MP -MF .deps/$(dir)/core/$*.d -MT $@ -I$(dir) $($(dir)_PACKAGE_CFLAGS)
+
+$(dir)/core/screen.o $(dir)/core/subscription.o $(dir)/core/tag.o: protocol/velox-server-protocol.h
+
+$(dir)/velox: $(HEADLESS_OBJECTS)
+	$(link) $(headless_PACKAGE_LIBS) -lm -lpthread -ldl
+
+.PHONY: velox-headless
+velox-headless: $(dir)/velox
+
+$(dir)/home:
+	@mkdir "$@"
+
+$(dir)/home/.velox.conf: velox.conf.sample | $(dir)/home
+	cp $< $@
+
+HEADLESS_CHECKS := map-unmap fullscreen floating
+
+check-headless bench-layout bench-clients: dir := $(dir)
+
+.PHONY: check-headless
+check-headless: $(dir)/velox $(dir)/home/.velox.conf
+	@for check in $(HEADLESS_CHECKS); do \
+		echo "  CHECK	$$check"; \
+		HOME=$(CURDIR)/$(dir)/home VELOX_LIBEXEC=/nonexistent \
+		    ./$(dir)/velox < $(dir)/$$check.in > /dev/null || exit 1; \
+	done
+
+.PHONY: bench-layout
+bench-layout: $(dir)/velox $(dir)/home/.velox.conf
+	HOME=$(CURDIR)/$(dir)/home VELOX_LIBEXEC=/nonexistent ./$(dir)/velox < $(dir)/bench-layout.in > /dev/null
+
+.PHONY: bench-clients
+bench-clients: $(dir)/velox $(dir)/home/.velox.conf
+	HOME=$(CURDIR)/$(dir)/home VELOX_LIBEXEC=/nonexistent ./$(dir)/velox < $(dir)/bench-clients.in > /dev/null
+
+include common.mk
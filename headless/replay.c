@@ -0,0 +1,252 @@
+/* velox: headless/replay.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "headless.h"
+#include "latency.h"
+#include "record.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+struct operation {
+	const char *name;
+	uint64_t count, calls, time;
+};
+
+static struct operation operations[] = {
+	[RECORD_SCREEN_NEW] = { "replay screen_new" },
+	[RECORD_SCREEN_USABLE] = { "replay screen_usable" },
+	[RECORD_WINDOW_NEW] = { "replay window_new" },
+	[RECORD_WINDOW_TITLE] = { "replay window_title" },
+	[RECORD_WINDOW_PARENT] = { "replay window_parent" },
+	[RECORD_WINDOW_ENTER] = { "replay window_enter" },
+	[RECORD_WINDOW_DESTROY] = { "replay window_destroy" },
+	[RECORD_BINDING] = { "replay binding" },
+};
+
+static struct {
+	char *data;
+	size_t size;
+} replay;
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+rectangle(struct swc_rectangle *r, const char *payload)
+{
+	struct record_rectangle record;
+
+	memcpy(&record, payload, sizeof(record));
+	r->x = record.x;
+	r->y = record.y;
+	r->width = record.width;
+	r->height = record.height;
+}
+
+static bool
+run_event(const struct record_event *event, const char *payload)
+{
+	struct swc_rectangle geometry, usable_geometry;
+	struct record_binding binding;
+	const char *app_id, *title;
+	uint32_t parent;
+
+	switch (event->type) {
+	case RECORD_SCREEN_NEW:
+		if (event->length != 2 * sizeof(struct record_rectangle))
+			return false;
+		rectangle(&geometry, payload);
+		rectangle(&usable_geometry, payload + sizeof(struct record_rectangle));
+		headless_new_screen(event->id, &geometry, &usable_geometry);
+		break;
+	case RECORD_SCREEN_USABLE:
+		if (event->length != sizeof(struct record_rectangle))
+			return false;
+		rectangle(&geometry, payload);
+		headless_set_usable_geometry(event->id, &geometry);
+		break;
+	case RECORD_WINDOW_NEW:
+		if (event->length == 0 || payload[event->length - 1] != '\0')
+			return false;
+		app_id = payload;
+		title = app_id + strlen(app_id) + 1;
+		if (title == payload + event->length)
+			title = NULL;
+		headless_new_window(event->id, app_id[0] ? app_id : NULL, title);
+		break;
+	case RECORD_WINDOW_TITLE:
+		if (event->length == 0 || payload[event->length - 1] != '\0')
+			return false;
+		headless_set_title(event->id, payload);
+		break;
+	case RECORD_WINDOW_PARENT:
+		if (event->length != sizeof(parent))
+			return false;
+		memcpy(&parent, payload, sizeof(parent));
+		headless_set_parent(event->id, parent);
+		break;
+	case RECORD_WINDOW_ENTER:
+		headless_enter(event->id);
+		break;
+	case RECORD_WINDOW_DESTROY:
+		headless_destroy(event->id);
+		break;
+	case RECORD_BINDING:
+		if (event->length != sizeof(binding))
+			return false;
+		memcpy(&binding, payload, sizeof(binding));
+		headless_binding(binding.type, binding.modifiers, binding.value, binding.state);
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void
+print_statistics(unsigned events, uint64_t time)
+{
+	struct operation *operation;
+	unsigned index;
+
+	fprintf(stderr, "replayed %u events in %.3fms (%.0f events/s), %llu swc calls\n",
+	        events, time / 1e6, time ? events * 1e9 / time : 0.0,
+	        (unsigned long long)headless_calls());
+	fprintf(stderr, "%-24s %8s %10s %10s %10s\n", "operation", "count", "swc calls", "calls/op", "mean");
+	for (index = 0; index < sizeof(operations) / sizeof(operations[0]); ++index) {
+		operation = &operations[index];
+		if (!operation->count)
+			continue;
+		fprintf(stderr, "%-24s %8llu %10llu %10.1f %8.1fus\n", operation->name,
+		        (unsigned long long)operation->count,
+		        (unsigned long long)operation->calls,
+		        (double)operation->calls / operation->count,
+		        operation->time / 1e3 / operation->count);
+	}
+}
+
+static void
+run(void *data)
+{
+	struct record_event event;
+	struct operation *operation;
+	size_t offset = sizeof(struct record_header);
+	uint64_t start, end, calls, total = 0;
+	unsigned events = 0;
+
+	while (offset + sizeof(event) <= replay.size) {
+		memcpy(&event, replay.data + offset, sizeof(event));
+		offset += sizeof(event);
+		if (event.length > replay.size - offset)
+			break;
+
+		calls = headless_calls();
+		start = now();
+		if (!run_event(&event, replay.data + offset)) {
+			fprintf(stderr, "replay: invalid event of type %u at offset %zu\n",
+			        event.type, offset - sizeof(event));
+			break;
+		}
+		end = now();
+		offset += event.length;
+
+		operation = &operations[event.type];
+		++operation->count;
+		operation->calls += headless_calls() - calls;
+		operation->time += end - start;
+		latency_record(operation->name, end - start);
+		total += end - start;
+		++events;
+	}
+
+	if (offset != replay.size)
+		fprintf(stderr, "replay: trailing data at offset %zu\n", offset);
+
+	print_statistics(events, total);
+	free(replay.data);
+	replay.data = NULL;
+	headless_quit();
+}
+
+bool
+replay_start(struct wl_event_loop *event_loop, const char *path)
+{
+	struct record_header header;
+	struct stat st;
+	ssize_t ret;
+	size_t size = 0;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		fprintf(stderr, "Could not open replay file '%s'\n", path);
+		goto error0;
+	}
+
+	if (fstat(fd, &st) == -1 || !(replay.data = malloc(st.st_size)))
+		goto error1;
+
+	while (size < st.st_size) {
+		if ((ret = read(fd, replay.data + size, st.st_size - size)) <= 0)
+			goto error2;
+		size += ret;
+	}
+	replay.size = size;
+
+	if (size < sizeof(header))
+		goto invalid;
+	memcpy(&header, replay.data, sizeof(header));
+	if (memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0
+	    || header.version != RECORD_VERSION)
+		goto invalid;
+
+	/* Start once velox has finished its setup and is dispatching events. */
+	if (!wl_event_loop_add_idle(event_loop, &run, NULL))
+		goto error2;
+
+	close(fd);
+
+	return true;
+
+invalid:
+	fprintf(stderr, "'%s' is not a velox recording\n", path);
+error2:
+	free(replay.data);
+error1:
+	close(fd);
+error0:
+	return false;
+}
@@ -0,0 +1,1007 @@
+/* velox: headless/swc.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE /* For RTLD_NEXT. */
+
+#include "swc.h"
+#include "headless.h"
+#include "stats.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server.h>
+#include <xkbcommon/xkbcommon.h>
+
+/* The driver reads commands, one per line, from standard input:
+ *
+ *   screen <id> <x> <y> <width> <height>
+ *   usable <id> <x> <y> <width> <height>
+ *   window [<id> [<app_id>]]
+ *   title <id> <title>
+ *   parent <id> <parent-id>|none
+ *   enter <id>
+ *   destroy <id>
+ *   key <modifiers> <keysym>
+ *   button <modifiers> <button>
+ *   connect <count>
+ *   disconnect <count>
+ *   dump
+ *   alloc_mark
+ *   alloc_check <max>
+ *   stat_mark
+ *   stat_check <counter> <max>
+ *   stat_expect <counter> <value>
+ *   spatial_check
+ *   expect focus <id>|none
+ *   expect shown|hidden <id>
+ *   expect geometry <id> <x> <y> <width> <height>
+ *   repeat <count> <command>[; <command>]...
+ *   quit
+ *
+ * window without an id uses one more than the highest id so far.
+ * Modifiers are a comma separated list of ctrl, alt, logo and shift, or none.
+ * connect starts the given number of in-process clients, each binding every
+ * velox_tag and velox_screen, and disconnect stops the most recent ones.
+ * alloc_check exits with failure if there were more than the given number of
+ * heap allocations since the last alloc_mark, and stat_check does the same for
+ * the velox_stats counter with the given name since the last stat_mark.
+ * stat_expect exits with failure unless the counter went up by exactly the
+ * given value. spatial_check checks the spatial index of every screen against
+ * a linear scan of its windows, and expect exits with failure if the state of a
+ * window is not as given. repeat runs the commands the given number of times
+ * without logging, and reports the mean time and number of swc calls per run to
+ * standard error.
+ * Unless standard input is a terminal, an invalid command, including an expect
+ * naming a window that doesn't exist, also exits with failure, so that a
+ * mistake in a script can't make it pass.
+ * Every call made by velox is recorded, one per line, to standard output or
+ * the file named by VELOX_HEADLESS_LOG.
+ *
+ * If VELOX_REPLAY names a file written with VELOX_RECORD, it is replayed
+ * instead, and calls are only logged if VELOX_HEADLESS_LOG is set. */
+
+struct screen {
+	struct swc_screen base;
+	const struct swc_screen_handler *handler;
+	void *data;
+	unsigned id;
+	struct wl_list link;
+};
+
+struct window {
+	struct swc_window base;
+	const struct swc_window_handler *handler;
+	void *data;
+	unsigned id;
+	struct swc_rectangle geometry;
+	uint32_t border_color, border_width;
+	bool visible, stacked, fullscreen;
+	struct wl_event_source *close;
+	struct wl_list link;
+};
+
+struct binding {
+	enum swc_binding_type type;
+	uint32_t modifiers, value;
+	swc_binding_handler handler;
+	void *data;
+};
+
+static struct {
+	struct wl_display *display;
+	struct wl_event_loop *event_loop;
+	const struct swc_manager *manager;
+	struct wl_event_source *input;
+	bool reading_file;
+	struct wl_list screens, windows;
+	struct wl_array bindings;
+	struct window *focus;
+	unsigned last_window;
+	bool replaying;
+	uint64_t calls;
+	FILE *log;
+	char buffer[4096];
+	size_t length;
+	uint32_t time;
+} swc;
+
+static void
+record(const char *format, ...)
+{
+	va_list args;
+
+	++swc.calls;
+	if (!swc.log)
+		return;
+
+	va_start(args, format);
+	vfprintf(swc.log, format, args);
+	va_end(args);
+	fputc('\n', swc.log);
+}
+
+/* Count heap allocations, so that tests can check that velox doesn't allocate
+ * where it shouldn't. This interposes on the allocator for the whole process,
+ * libraries included; the headless swc itself allocates through the next
+ * definition so that its own allocations aren't counted. */
+static void *(*real_malloc)(size_t size);
+static void *(*real_calloc)(size_t count, size_t size);
+static void *(*real_realloc)(void *data, size_t size);
+static unsigned long allocations, allocations_mark;
+static uint64_t stats_mark[NUM_STATS];
+
+/* dlsym may allocate before the real allocator is known. */
+static union {
+	long double align;
+	char data[1024];
+} bootstrap;
+static size_t bootstrap_used;
+static bool resolving;
+
+static void *
+bootstrap_alloc(size_t size)
+{
+	void *data;
+
+	size = (size + sizeof(long double) - 1) & ~(sizeof(long double) - 1);
+	if (size > sizeof(bootstrap.data) - bootstrap_used)
+		return NULL;
+	data = bootstrap.data + bootstrap_used;
+	bootstrap_used += size;
+	return data;
+}
+
+static void
+resolve(void)
+{
+	resolving = true;
+	*(void **)&real_malloc = dlsym(RTLD_NEXT, "malloc");
+	*(void **)&real_calloc = dlsym(RTLD_NEXT, "calloc");
+	*(void **)&real_realloc = dlsym(RTLD_NEXT, "realloc");
+	resolving = false;
+
+	if (!real_malloc || !real_calloc || !real_realloc)
+		abort();
+}
+
+void *
+malloc(size_t size)
+{
+	if (resolving)
+		return bootstrap_alloc(size);
+	if (!real_malloc)
+		resolve();
+	++allocations;
+	return real_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size)
+{
+	if (resolving)
+		return count && size > SIZE_MAX / count ? NULL : bootstrap_alloc(count * size);
+	if (!real_calloc)
+		resolve();
+	++allocations;
+	return real_calloc(count, size);
+}
+
+void *
+realloc(void *data, size_t size)
+{
+	if (!real_realloc)
+		resolve();
+	++allocations;
+	return real_realloc(data, size);
+}
+
+static char *
+copy_string(const char *string)
+{
+	size_t size = strlen(string) + 1;
+	char *copy;
+
+	if ((copy = real_malloc(size)))
+		memcpy(copy, string, size);
+
+	return copy;
+}
+
+static struct window *
+get_window(struct swc_window *base)
+{
+	return (struct window *)((char *)base - offsetof(struct window, base));
+}
+
+static struct window *
+find_window(unsigned id)
+{
+	struct window *window;
+
+	wl_list_for_each (window, &swc.windows, link) {
+		if (window->id == id)
+			return window;
+	}
+
+	fprintf(stderr, "headless: no window %u\n", id);
+	return NULL;
+}
+
+static struct screen *
+find_screen(unsigned id)
+{
+	struct screen *screen;
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen->id == id)
+			return screen;
+	}
+
+	fprintf(stderr, "headless: no screen %u\n", id);
+	return NULL;
+}
+
+/* Screens */
+void
+swc_screen_set_handler(struct swc_screen *base, const struct swc_screen_handler *handler, void *data)
+{
+	struct screen *screen = wl_container_of(base, screen, base);
+
+	screen->handler = handler;
+	screen->data = data;
+}
+
+/* Windows */
+void
+swc_window_set_handler(struct swc_window *base, const struct swc_window_handler *handler, void *data)
+{
+	struct window *w = get_window(base);
+
+	w->handler = handler;
+	w->data = data;
+}
+
+static void
+destroy_window(struct window *window)
+{
+	if (window->close)
+		wl_event_source_remove(window->close);
+	if (window->handler && window->handler->destroy)
+		window->handler->destroy(window->data);
+	if (swc.focus == window)
+		swc.focus = NULL;
+	wl_list_remove(&window->link);
+	free(window->base.title);
+	free(window->base.app_id);
+	free(window);
+}
+
+static void
+handle_close(void *data)
+{
+	struct window *window = data;
+
+	/* Idle sources are removed after they are dispatched. */
+	window->close = NULL;
+	record("window %u closed", window->id);
+	destroy_window(window);
+}
+
+void
+swc_window_close(struct swc_window *base)
+{
+	struct window *w = get_window(base);
+
+	record("window %u close", w->id);
+
+	/* A well-behaved client destroys its window in response, but not until
+	 * it has had a chance to process the request. When replaying, the
+	 * destruction is part of the recording. */
+	if (!w->close && !swc.replaying)
+		w->close = wl_event_loop_add_idle(swc.event_loop, &handle_close, w);
+}
+
+void
+swc_window_show(struct swc_window *base)
+{
+	struct window *w = get_window(base);
+
+	w->visible = true;
+	record("window %u show", w->id);
+}
+
+void
+swc_window_hide(struct swc_window *base)
+{
+	struct window *w = get_window(base);
+
+	w->visible = false;
+	record("window %u hide", w->id);
+}
+
+void
+swc_window_focus(struct swc_window *base)
+{
+	swc.focus = base ? get_window(base) : NULL;
+	if (swc.focus)
+		record("window %u focus", swc.focus->id);
+	else
+		record("focus none");
+}
+
+void
+swc_window_set_stacked(struct swc_window *base)
+{
+	struct window *w = get_window(base);
+
+	w->stacked = true;
+	w->fullscreen = false;
+	record("window %u stacked", w->id);
+}
+
+void
+swc_window_set_tiled(struct swc_window *base)
+{
+	struct window *w = get_window(base);
+
+	w->stacked = false;
+	w->fullscreen = false;
+	record("window %u tiled", w->id);
+}
+
+void
+swc_window_set_fullscreen(struct swc_window *base, struct swc_screen *swc_screen)
+{
+	struct window *w = get_window(base);
+	struct screen *screen = wl_container_of(swc_screen, screen, base);
+
+	w->stacked = false;
+	w->fullscreen = true;
+	w->geometry = screen->base.geometry;
+	record("window %u fullscreen %u", w->id, screen->id);
+}
+
+void
+swc_window_set_position(struct swc_window *base, int32_t x, int32_t y)
+{
+	struct window *w = get_window(base);
+
+	w->geometry.x = x;
+	w->geometry.y = y;
+	record("window %u position %d %d", w->id, x, y);
+}
+
+void
+swc_window_set_size(struct swc_window *base, uint32_t width, uint32_t height)
+{
+	struct window *w = get_window(base);
+
+	/* A size of 0 lets the client choose, which we don't model. */
+	if (width && height) {
+		w->geometry.width = width;
+		w->geometry.height = height;
+	}
+	record("window %u size %u %u", w->id, width, height);
+}
+
+void
+swc_window_set_geometry(struct swc_window *base, const struct swc_rectangle *geometry)
+{
+	struct window *w = get_window(base);
+
+	w->geometry = *geometry;
+	record("window %u geometry %d %d %u %u", w->id,
+	       geometry->x, geometry->y, geometry->width, geometry->height);
+}
+
+void
+swc_window_set_border(struct swc_window *base, uint32_t color, uint32_t width)
+{
+	struct window *w = get_window(base);
+
+	w->border_color = color;
+	w->border_width = width;
+	record("window %u border %06x %u", w->id, color, width);
+}
+
+void
+swc_window_begin_move(struct swc_window *base)
+{
+	record("window %u begin_move", get_window(base)->id);
+}
+
+void
+swc_window_end_move(struct swc_window *base)
+{
+	record("window %u end_move", get_window(base)->id);
+}
+
+void
+swc_window_begin_resize(struct swc_window *base, uint32_t edges)
+{
+	record("window %u begin_resize %u", get_window(base)->id, edges);
+}
+
+void
+swc_window_end_resize(struct swc_window *base)
+{
+	record("window %u end_resize", get_window(base)->id);
+}
+
+/* Bindings */
+int
+swc_add_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t value, swc_binding_handler handler, void *data)
+{
+	struct binding *binding;
+
+	if (!(binding = wl_array_add(&swc.bindings, sizeof *binding)))
+		return -ENOMEM;
+
+	binding->type = type;
+	binding->modifiers = modifiers;
+	binding->value = value;
+	binding->handler = handler;
+	binding->data = data;
+	record("binding %s %x %x", type == SWC_BINDING_KEY ? "key" : "button", modifiers, value);
+
+	return 0;
+}
+
+static bool
+parse_modifiers(const char *string, uint32_t *modifiers)
+{
+	static const struct {
+		const char *name;
+		uint32_t value;
+	} names[] = {
+		{ "ctrl", SWC_MOD_CTRL },
+		{ "alt", SWC_MOD_ALT },
+		{ "logo", SWC_MOD_LOGO },
+		{ "shift", SWC_MOD_SHIFT },
+	};
+	size_t index, length;
+
+	*modifiers = 0;
+	if (strcmp(string, "none") == 0)
+		return true;
+
+	for (;;) {
+		length = strcspn(string, ",");
+		for (index = 0; index < sizeof names / sizeof names[0]; ++index) {
+			if (strlen(names[index].name) == length
+			    && strncmp(string, names[index].name, length) == 0)
+				break;
+		}
+		if (index == sizeof names / sizeof names[0])
+			return false;
+		*modifiers |= names[index].value;
+		if (!string[length])
+			return true;
+		string += length + 1;
+	}
+}
+
+void
+headless_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t value, uint32_t state)
+{
+	struct binding *binding, *match = NULL;
+
+	wl_array_for_each (binding, &swc.bindings) {
+		if (binding->type != type || binding->value != value)
+			continue;
+		if (binding->modifiers == modifiers) {
+			match = binding;
+			break;
+		}
+		if (binding->modifiers == SWC_MOD_ANY && !match)
+			match = binding;
+	}
+
+	if (!match) {
+		record("%s %x %x unbound", type == SWC_BINDING_KEY ? "key" : "button", modifiers, value);
+		return;
+	}
+
+	match->handler(match->data, ++swc.time, value, state);
+}
+
+static void
+dump(void)
+{
+	struct screen *screen;
+	struct window *window;
+	struct swc_rectangle *g;
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		g = &screen->base.usable_geometry;
+		record("state screen %u usable %d %d %u %u", screen->id, g->x, g->y, g->width, g->height);
+	}
+	wl_list_for_each (window, &swc.windows, link) {
+		g = &window->geometry;
+		record("state window %u %s %s%s geometry %d %d %u %u border %06x %u", window->id,
+		       window->visible ? "shown" : "hidden",
+		       window->fullscreen ? "fullscreen" : window->stacked ? "stacked" : "tiled",
+		       swc.focus == window ? " focused" : "",
+		       g->x, g->y, g->width, g->height,
+		       window->border_color, window->border_width);
+	}
+}
+
+void
+headless_new_screen(unsigned id, const struct swc_rectangle *geometry, const struct swc_rectangle *usable_geometry)
+{
+	struct screen *screen;
+
+	if (!(screen = real_calloc(1, sizeof(*screen))))
+		return;
+	screen->id = id;
+	screen->base.geometry = *geometry;
+	screen->base.usable_geometry = *usable_geometry;
+	wl_list_insert(swc.screens.prev, &screen->link);
+	swc.manager->new_screen(&screen->base);
+}
+
+void
+headless_set_usable_geometry(unsigned id, const struct swc_rectangle *geometry)
+{
+	struct screen *screen;
+
+	if (!(screen = find_screen(id)))
+		return;
+	screen->base.usable_geometry = *geometry;
+	if (screen->handler && screen->handler->usable_geometry_changed)
+		screen->handler->usable_geometry_changed(screen->data);
+}
+
+void
+headless_new_window(unsigned id, const char *app_id, const char *title)
+{
+	struct window *window;
+
+	if (!(window = real_calloc(1, sizeof(*window))))
+		return;
+	window->id = id;
+	if (id > swc.last_window)
+		swc.last_window = id;
+	window->base.app_id = app_id ? copy_string(app_id) : NULL;
+	window->base.title = title ? copy_string(title) : NULL;
+	wl_list_insert(swc.windows.prev, &window->link);
+	swc.manager->new_window(&window->base);
+}
+
+void
+headless_set_title(unsigned id, const char *title)
+{
+	struct window *window;
+
+	if (!(window = find_window(id)))
+		return;
+	free(window->base.title);
+	window->base.title = copy_string(title);
+	if (window->handler && window->handler->title_changed)
+		window->handler->title_changed(window->data);
+}
+
+void
+headless_set_parent(unsigned id, unsigned parent_id)
+{
+	struct window *window, *parent = NULL;
+
+	if (!(window = find_window(id)))
+		return;
+	if (parent_id && !(parent = find_window(parent_id)))
+		return;
+	window->base.parent = parent ? &parent->base : NULL;
+	if (window->handler && window->handler->parent_changed)
+		window->handler->parent_changed(window->data);
+}
+
+void
+headless_enter(unsigned id)
+{
+	struct window *window;
+
+	if (!(window = find_window(id)))
+		return;
+	if (window->handler && window->handler->entered)
+		window->handler->entered(window->data);
+}
+
+void
+headless_destroy(unsigned id)
+{
+	struct window *window;
+
+	if ((window = find_window(id)))
+		destroy_window(window);
+}
+
+unsigned
+headless_window_id(struct swc_window *base)
+{
+	return get_window(base)->id;
+}
+
+const struct swc_rectangle *
+headless_window_geometry(struct swc_window *base)
+{
+	return &get_window(base)->geometry;
+}
+
+uint64_t
+headless_calls(void)
+{
+	return swc.calls;
+}
+
+void
+headless_quit(void)
+{
+	swc.reading_file = false;
+	if (swc.input) {
+		wl_event_source_remove(swc.input);
+		swc.input = NULL;
+	}
+
+	/* velox runs its own loop rather than wl_display_run, so ask it to exit
+	 * the same way a user would. */
+	raise(SIGTERM);
+}
+
+static void
+fail(const char *format, ...)
+{
+	va_list args;
+
+	fputs("headless: ", stderr);
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fputc('\n', stderr);
+	exit(EXIT_FAILURE);
+}
+
+static bool
+expect(char *line)
+{
+	struct swc_rectangle g;
+	struct window *window;
+	char name[64], argument[64];
+	unsigned id;
+
+	if (sscanf(line, "%63s %63s", name, argument) != 2)
+		return false;
+
+	if (strcmp(name, "focus") == 0) {
+		if (strcmp(argument, "none") == 0) {
+			if (swc.focus)
+				fail("expected no focus, but window %u is focused", swc.focus->id);
+			return true;
+		}
+		if (!(window = find_window(strtoul(argument, NULL, 10))))
+			return false;
+		if (swc.focus != window) {
+			if (swc.focus)
+				fail("expected window %u focused, but window %u is", window->id, swc.focus->id);
+			fail("expected window %u focused, but nothing is", window->id);
+		}
+	} else if (strcmp(name, "shown") == 0 || strcmp(name, "hidden") == 0) {
+		if (!(window = find_window(strtoul(argument, NULL, 10))))
+			return false;
+		if (window->visible != (name[0] == 's'))
+			fail("expected window %u %s", window->id, name);
+	} else if (strcmp(name, "geometry") == 0) {
+		if (sscanf(line, "%*s %u %d %d %u %u", &id, &g.x, &g.y, &g.width, &g.height) != 5)
+			return false;
+		if (!(window = find_window(id)))
+			return false;
+		if (window->geometry.x != g.x || window->geometry.y != g.y
+		    || window->geometry.width != g.width || window->geometry.height != g.height) {
+			fail("expected window %u geometry %d %d %u %u, but it is %d %d %u %u", id,
+			     g.x, g.y, g.width, g.height, window->geometry.x, window->geometry.y,
+			     window->geometry.width, window->geometry.height);
+		}
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_command(char *line);
+
+static void
+repeat(unsigned count, const char *commands)
+{
+	FILE *log = swc.log;
+	uint64_t calls = swc.calls;
+	struct timespec start, end;
+	double elapsed = 0;
+	char buffer[sizeof(swc.buffer)], *command, *next;
+	unsigned index;
+
+	if (count == 0)
+		return;
+
+	swc.log = NULL;
+	for (index = 0; index < count; ++index) {
+		/* Commands are split in place, so split a fresh copy every time. */
+		strcpy(buffer, commands);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (command = buffer; command; command = next) {
+			if ((next = strchr(command, ';')))
+				*next++ = '\0';
+			run_command(command);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+		/* Throwing away the events sent to clients is not velox's work. */
+		headless_drain();
+	}
+	swc.log = log;
+
+	fprintf(stderr, "%-32s %8u runs %10.1fus %10.1f swc calls\n", commands, count,
+	        elapsed / count / 1000, (double)(swc.calls - calls) / count);
+}
+
+static bool
+run_command(char *line)
+{
+	struct swc_rectangle g;
+	char name[64], argument[256], symbol[64];
+	unsigned id;
+	uint32_t modifiers, value;
+	int offset, n;
+	enum swc_binding_type type;
+
+	if (sscanf(line, "%63s%n", name, &offset) != 1 || name[0] == '#')
+		return true;
+	line += offset;
+
+	if (strcmp(name, "screen") == 0 || strcmp(name, "usable") == 0) {
+		if (sscanf(line, "%u %d %d %u %u", &id, &g.x, &g.y, &g.width, &g.height) != 5)
+			goto invalid;
+		if (name[0] == 'u')
+			headless_set_usable_geometry(id, &g);
+		else
+			headless_new_screen(id, &g, &g);
+	} else if (strcmp(name, "window") == 0) {
+		if ((n = sscanf(line, "%u %255s", &id, argument)) == EOF)
+			id = swc.last_window + 1;
+		else if (n < 1)
+			goto invalid;
+		headless_new_window(id, n == 2 ? argument : NULL, NULL);
+	} else if (strcmp(name, "title") == 0) {
+		if (sscanf(line, "%u %n", &id, &offset) != 1)
+			goto invalid;
+		headless_set_title(id, line + offset);
+	} else if (strcmp(name, "parent") == 0) {
+		if (sscanf(line, "%u %255s", &id, argument) != 2)
+			goto invalid;
+		headless_set_parent(id, strcmp(argument, "none") == 0 ? 0 : strtoul(argument, NULL, 10));
+	} else if (strcmp(name, "enter") == 0) {
+		if (sscanf(line, "%u", &id) != 1)
+			goto invalid;
+		headless_enter(id);
+	} else if (strcmp(name, "destroy") == 0) {
+		if (sscanf(line, "%u", &id) != 1)
+			goto invalid;
+		headless_destroy(id);
+	} else if (strcmp(name, "key") == 0 || strcmp(name, "button") == 0) {
+		if (sscanf(line, "%255s %63s", argument, symbol) != 2)
+			goto invalid;
+		if (!parse_modifiers(argument, &modifiers))
+			goto invalid;
+		if (name[0] == 'k') {
+			type = SWC_BINDING_KEY;
+			if ((value = xkb_keysym_from_name(symbol, 0)) == XKB_KEY_NoSymbol)
+				goto invalid;
+		} else {
+			type = SWC_BINDING_BUTTON;
+			value = strtoul(symbol, NULL, 0);
+		}
+		headless_binding(type, modifiers, value, 1);
+		headless_binding(type, modifiers, value, 0);
+	} else if (strcmp(name, "connect") == 0 || strcmp(name, "disconnect") == 0) {
+		if (sscanf(line, "%u", &id) != 1)
+			goto invalid;
+		if (name[0] == 'd')
+			headless_disconnect(id);
+		else if (!headless_connect(id))
+			fail("could not connect %u clients", id);
+	} else if (strcmp(name, "dump") == 0) {
+		dump();
+	} else if (strcmp(name, "alloc_mark") == 0) {
+		allocations_mark = allocations;
+	} else if (strcmp(name, "alloc_check") == 0) {
+		if (sscanf(line, "%u", &id) != 1)
+			goto invalid;
+		record("allocations %lu", allocations - allocations_mark);
+		if (allocations - allocations_mark > id) {
+			fprintf(stderr, "headless: %lu allocations since alloc_mark, expected at most %u\n",
+			        allocations - allocations_mark, id);
+			exit(EXIT_FAILURE);
+		}
+	} else if (strcmp(name, "stat_mark") == 0) {
+		memcpy(stats_mark, stats, sizeof(stats_mark));
+	} else if (strcmp(name, "stat_check") == 0 || strcmp(name, "stat_expect") == 0) {
+		if (sscanf(line, "%255s %u", argument, &id) != 2)
+			goto invalid;
+		for (n = 0; n < NUM_STATS && strcmp(stats_name(n), argument) != 0; ++n)
+			;
+		if (n == NUM_STATS)
+			goto invalid;
+		record("stat %s %" PRIu64, argument, stats[n] - stats_mark[n]);
+		if (name[5] == 'c' && stats[n] - stats_mark[n] > id)
+			fail("%" PRIu64 " %s since stat_mark, expected at most %u", stats[n] - stats_mark[n], argument, id);
+		if (name[5] == 'e' && stats[n] - stats_mark[n] != id)
+			fail("%" PRIu64 " %s since stat_mark, expected %u", stats[n] - stats_mark[n], argument, id);
+	} else if (strcmp(name, "spatial_check") == 0) {
+		if (!headless_check_spatial())
+			exit(EXIT_FAILURE);
+	} else if (strcmp(name, "expect") == 0) {
+		if (!expect(line))
+			goto invalid;
+	} else if (strcmp(name, "repeat") == 0) {
+		if (sscanf(line, "%u %n", &id, &offset) != 1)
+			goto invalid;
+		repeat(id, line + offset);
+	} else if (strcmp(name, "quit") == 0) {
+		return false;
+	} else {
+		goto invalid;
+	}
+
+	return true;
+
+invalid:
+	if (!isatty(STDIN_FILENO))
+		fail("invalid command: %s%s", name, line);
+	fprintf(stderr, "headless: invalid command: %s%s\n", name, line);
+	return true;
+}
+
+static int
+handle_input(int fd, uint32_t mask, void *data)
+{
+	char *line, *end;
+	ssize_t ret;
+
+	ret = read(fd, swc.buffer + swc.length, sizeof swc.buffer - swc.length - 1);
+	if (ret <= 0)
+		goto quit;
+	swc.length += ret;
+	swc.buffer[swc.length] = '\0';
+
+	for (line = swc.buffer; (end = strchr(line, '\n')); line = end + 1) {
+		*end = '\0';
+		if (!run_command(line))
+			goto quit;
+		headless_drain();
+	}
+
+	swc.length -= line - swc.buffer;
+	memmove(swc.buffer, line, swc.length);
+
+	/* Drop lines that don't fit in the buffer. */
+	if (swc.length == sizeof swc.buffer - 1)
+		swc.length = 0;
+
+	return 0;
+
+quit:
+	headless_quit();
+	return 0;
+}
+
+static void
+read_file(void *data)
+{
+	handle_input(STDIN_FILENO, WL_EVENT_READABLE, NULL);
+	if (swc.reading_file && !wl_event_loop_add_idle(swc.event_loop, &read_file, NULL))
+		headless_quit();
+}
+
+bool
+swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, const struct swc_manager *manager)
+{
+	const char *path, *replay;
+	struct stat st;
+
+	swc.display = display;
+	swc.event_loop = event_loop ? event_loop : wl_display_get_event_loop(display);
+	swc.manager = manager;
+	wl_list_init(&swc.screens);
+	wl_list_init(&swc.windows);
+	wl_array_init(&swc.bindings);
+
+	replay = getenv("VELOX_REPLAY");
+	swc.replaying = replay != NULL;
+
+	if ((path = getenv("VELOX_HEADLESS_LOG"))) {
+		if (!(swc.log = fopen(path, "w")))
+			goto error0;
+	} else if (!swc.replaying) {
+		swc.log = stdout;
+	}
+	if (swc.log)
+		setvbuf(swc.log, NULL, _IOLBF, 0);
+
+	if (swc.replaying) {
+		if (!replay_start(swc.event_loop, replay))
+			goto error1;
+	} else if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode)) {
+		/* epoll can't wait on regular files, but they are always readable, so
+		 * read them from an idle source instead. */
+		if (!wl_event_loop_add_idle(swc.event_loop, &read_file, NULL))
+			goto error1;
+		swc.reading_file = true;
+	} else {
+		swc.input = wl_event_loop_add_fd(swc.event_loop, STDIN_FILENO, WL_EVENT_READABLE, &handle_input, NULL);
+		if (!swc.input)
+			goto error1;
+	}
+
+	return true;
+
+error1:
+	if (swc.log && swc.log != stdout)
+		fclose(swc.log);
+error0:
+	return false;
+}
+
+void
+swc_finalize(void)
+{
+	struct window *window, *tmp;
+	struct screen *screen, *screen_tmp;
+
+	if (swc.input)
+		wl_event_source_remove(swc.input);
+	wl_list_for_each_safe (window, tmp, &swc.windows, link) {
+		wl_list_remove(&window->link);
+		free(window->base.title);
+		free(window->base.app_id);
+		free(window);
+	}
+	wl_list_for_each_safe (screen, screen_tmp, &swc.screens, link) {
+		wl_list_remove(&screen->link);
+		free(screen);
+	}
+	wl_array_release(&swc.bindings);
+	record("finalize");
+	if (swc.log && swc.log != stdout)
+		fclose(swc.log);
+}
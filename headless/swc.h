@@ -0,0 +1,129 @@
+/* velox: headless/swc.h
+ *
+ * Copyright (c) 2014 Michael Forney <mforney@mforney.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* A headless stand-in for the parts of the swc API used by velox. Every call
+ * made by velox is recorded, and screens, windows and input are injected by a
+ * simple line-based driver reading from stdin. */
+
+#ifndef SWC_H
+#define SWC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct libinput_device;
+struct wl_display;
+struct wl_event_loop;
+
+struct swc_rectangle {
+	int32_t x, y;
+	uint32_t width, height;
+};
+
+/* Screens */
+struct swc_screen_handler {
+	void (*destroy)(void *data);
+	void (*geometry_changed)(void *data);
+	void (*usable_geometry_changed)(void *data);
+	void (*entered)(void *data);
+};
+
+struct swc_screen {
+	struct swc_rectangle geometry;
+	struct swc_rectangle usable_geometry;
+};
+
+void swc_screen_set_handler(struct swc_screen *screen, const struct swc_screen_handler *handler, void *data);
+
+/* Windows */
+struct swc_window_handler {
+	void (*destroy)(void *data);
+	void (*title_changed)(void *data);
+	void (*app_id_changed)(void *data);
+	void (*parent_changed)(void *data);
+	void (*entered)(void *data);
+	void (*move)(void *data);
+	void (*resize)(void *data);
+};
+
+struct swc_window {
+	char *title;
+	char *app_id;
+	struct swc_window *parent;
+};
+
+enum {
+	SWC_WINDOW_EDGE_AUTO = 0,
+	SWC_WINDOW_EDGE_TOP = (1 << 0),
+	SWC_WINDOW_EDGE_BOTTOM = (1 << 1),
+	SWC_WINDOW_EDGE_LEFT = (1 << 2),
+	SWC_WINDOW_EDGE_RIGHT = (1 << 3),
+};
+
+void swc_window_set_handler(struct swc_window *window, const struct swc_window_handler *handler, void *data);
+void swc_window_close(struct swc_window *window);
+void swc_window_show(struct swc_window *window);
+void swc_window_hide(struct swc_window *window);
+void swc_window_focus(struct swc_window *window);
+void swc_window_set_stacked(struct swc_window *window);
+void swc_window_set_tiled(struct swc_window *window);
+void swc_window_set_fullscreen(struct swc_window *window, struct swc_screen *screen);
+void swc_window_set_position(struct swc_window *window, int32_t x, int32_t y);
+void swc_window_set_size(struct swc_window *window, uint32_t width, uint32_t height);
+void swc_window_set_geometry(struct swc_window *window, const struct swc_rectangle *geometry);
+void swc_window_set_border(struct swc_window *window, uint32_t color, uint32_t width);
+void swc_window_begin_move(struct swc_window *window);
+void swc_window_end_move(struct swc_window *window);
+void swc_window_begin_resize(struct swc_window *window, uint32_t edges);
+void swc_window_end_resize(struct swc_window *window);
+
+/* Bindings */
+enum {
+	SWC_MOD_CTRL = 1 << 0,
+	SWC_MOD_ALT = 1 << 1,
+	SWC_MOD_LOGO = 1 << 2,
+	SWC_MOD_SHIFT = 1 << 3,
+	SWC_MOD_ANY = ~0,
+};
+
+enum swc_binding_type {
+	SWC_BINDING_KEY,
+	SWC_BINDING_BUTTON,
+};
+
+typedef void (*swc_binding_handler)(void *data, uint32_t time, uint32_t value, uint32_t state);
+
+int swc_add_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t value, swc_binding_handler handler, void *data);
+
+struct swc_manager {
+	void (*new_screen)(struct swc_screen *screen);
+	void (*new_window)(struct swc_window *window);
+	void (*new_device)(struct libinput_device *device);
+	void (*activate)(void);
+	void (*deactivate)(void);
+};
+
+bool swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, const struct swc_manager *manager);
+void swc_finalize(void);
+
+#endif
@@ -0,0 +1,161 @@
+/* velox: intern.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "intern.h"
+#include "stats.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Strings longer than this get a chunk of their own. */
+#define CHUNK_SIZE 4096
+
+struct chunk {
+	struct chunk *next;
+	size_t used, size;
+	char data[];
+};
+
+static struct {
+	struct chunk *chunks;
+	/* Open addressing hash table of the interned strings. */
+	const char **table;
+	size_t size, count;
+} arena;
+
+static uint32_t
+hash(const char *string)
+{
+	uint32_t hash = 2166136261;
+
+	for (; *string; ++string)
+		hash = (hash ^ (unsigned char)*string) * 16777619;
+
+	return hash;
+}
+
+static const char **
+find(const char **table, size_t size, const char *string)
+{
+	size_t index = hash(string) & (size - 1);
+
+	while (table[index] && strcmp(table[index], string) != 0)
+		index = (index + 1) & (size - 1);
+
+	return &table[index];
+}
+
+static bool
+grow_table(void)
+{
+	const char **table;
+	size_t index, size = arena.size ? arena.size * 2 : 256;
+
+	if (!(table = calloc(size, sizeof(*table))))
+		return false;
+	++stats[STAT_ALLOCATIONS];
+
+	for (index = 0; index < arena.size; ++index) {
+		if (arena.table[index])
+			*find(table, size, arena.table[index]) = arena.table[index];
+	}
+
+	free(arena.table);
+	arena.table = table;
+	arena.size = size;
+
+	return true;
+}
+
+static char *
+allocate(size_t length)
+{
+	struct chunk *chunk = arena.chunks;
+	size_t size;
+
+	if (!chunk || chunk->size - chunk->used < length) {
+		size = length > CHUNK_SIZE ? length : CHUNK_SIZE;
+		if (!(chunk = malloc(sizeof(*chunk) + size)))
+			return NULL;
+		++stats[STAT_ALLOCATIONS];
+		chunk->used = 0;
+		chunk->size = size;
+		chunk->next = arena.chunks;
+		arena.chunks = chunk;
+	}
+
+	chunk->used += length;
+
+	return chunk->data + chunk->used - length;
+}
+
+const char *
+intern(const char *string)
+{
+	const char **slot, *interned;
+	size_t length;
+	char *copy;
+
+	if ((interned = intern_lookup(string)))
+		return interned;
+
+	/* Keep the table at most half full. */
+	if (2 * (arena.count + 1) > arena.size && !grow_table())
+		return NULL;
+
+	slot = find(arena.table, arena.size, string);
+	length = strlen(string) + 1;
+
+	if (!(copy = allocate(length)))
+		return NULL;
+
+	memcpy(copy, string, length);
+	++arena.count;
+
+	return *slot = copy;
+}
+
+const char *
+intern_lookup(const char *string)
+{
+	return arena.size ? *find(arena.table, arena.size, string) : NULL;
+}
+
+void
+intern_finalize(void)
+{
+	struct chunk *chunk, *next;
+
+	for (chunk = arena.chunks; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	free(arena.table);
+	arena.chunks = NULL;
+	arena.table = NULL;
+	arena.size = 0;
+	arena.count = 0;
+}
@@ -0,0 +1,42 @@
+/* velox: intern.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_INTERN_H
+#define VELOX_INTERN_H
+
+/**
+ * Strings created while parsing the configuration are interned in an arena.
+ * Each distinct string is stored once, so two interned strings are equal if
+ * and only if they are the same pointer. Interned strings are never freed
+ * individually; intern_finalize() releases all of them at once.
+ */
+
+/* Returns the interned copy of the string, or NULL on allocation failure. */
+const char *intern(const char *string);
+/* Returns the interned copy of the string if there is one, or NULL. Never
+ * allocates. */
+const char *intern_lookup(const char *string);
+
+void intern_finalize(void);
+
+#endif
@@ -0,0 +1,201 @@
+/* velox: latency.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "latency.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-util.h>
+
+/* Values are bucketed with a fixed number of sub-buckets per power of two, so
+ * the relative error is bounded (1/16) across the whole range. */
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HALF_SUB_BUCKETS (SUB_BUCKETS / 2)
+#define MAX_VALUE ((UINT64_C(1) << 32) - 1)
+#define NUM_BUCKETS ((32 - SUB_BUCKET_BITS + 1) * HALF_SUB_BUCKETS + HALF_SUB_BUCKETS)
+
+struct histogram {
+	const char *name;
+	uint64_t counts[NUM_BUCKETS];
+	uint64_t count, max;
+	struct wl_list link;
+};
+
+static struct wl_list histograms = { &histograms, &histograms };
+
+/* The binding currently being handled. */
+static struct {
+	bool active, changed;
+	uint64_t start, end;
+} pending;
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static unsigned
+bucket_index(uint64_t value)
+{
+	unsigned shift;
+
+	if (value < SUB_BUCKETS)
+		return value;
+
+	/* Shift the value so that it lies in the upper half of the sub-buckets. */
+	shift = 63 - __builtin_clzll(value) - (SUB_BUCKET_BITS - 1);
+	return shift * HALF_SUB_BUCKETS + (value >> shift);
+}
+
+/* The smallest value in a bucket. */
+static uint64_t
+bucket_value(unsigned index)
+{
+	unsigned shift;
+
+	if (index < SUB_BUCKETS)
+		return index;
+
+	shift = index / HALF_SUB_BUCKETS - 1;
+	return (uint64_t)(index % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS) << shift;
+}
+
+static struct histogram *
+find_histogram(const char *name)
+{
+	struct histogram *histogram;
+
+	wl_list_for_each (histogram, &histograms, link) {
+		if (histogram->name == name || strcmp(histogram->name, name) == 0)
+			return histogram;
+	}
+
+	if (!(histogram = calloc(1, sizeof(*histogram))))
+		return NULL;
+	histogram->name = name;
+	wl_list_insert(histograms.prev, &histogram->link);
+
+	return histogram;
+}
+
+void
+latency_begin(void)
+{
+	pending.active = true;
+	pending.changed = false;
+	pending.start = now();
+}
+
+void
+latency_mark(void)
+{
+	if (!pending.active)
+		return;
+
+	pending.changed = true;
+	pending.end = now();
+}
+
+void
+latency_end(const char *name)
+{
+	if (!pending.active)
+		return;
+	pending.active = false;
+
+	/* Actions that didn't change anything on screen aren't interesting. */
+	if (pending.changed)
+		latency_record(name, pending.end - pending.start);
+}
+
+void
+latency_record(const char *name, uint64_t value)
+{
+	struct histogram *histogram;
+
+	if (!(histogram = find_histogram(name)))
+		return;
+
+	if (value > MAX_VALUE)
+		value = MAX_VALUE;
+
+	++histogram->counts[bucket_index(value)];
+	++histogram->count;
+	if (value > histogram->max)
+		histogram->max = value;
+}
+
+/* The highest value equivalent to the given percentile. */
+static uint64_t
+percentile(const struct histogram *histogram, unsigned percent)
+{
+	uint64_t target = (histogram->count * percent + 99) / 100, total = 0, value;
+	unsigned index;
+
+	for (index = 0; index < NUM_BUCKETS; ++index) {
+		total += histogram->counts[index];
+		if (total >= target)
+			break;
+	}
+
+	value = bucket_value(index + 1) - 1;
+	return value < histogram->max ? value : histogram->max;
+}
+
+void
+latency_print(void)
+{
+	struct histogram *histogram;
+
+	if (wl_list_empty(&histograms))
+		return;
+
+	fprintf(stderr, "%-24s %8s %10s %10s %10s %10s\n", "action", "count", "p50", "p90", "p99", "max");
+	wl_list_for_each (histogram, &histograms, link) {
+		fprintf(stderr, "%-24s %8llu %8.1fus %8.1fus %8.1fus %8.1fus\n", histogram->name,
+		        (unsigned long long)histogram->count,
+		        percentile(histogram, 50) / 1000.0,
+		        percentile(histogram, 90) / 1000.0,
+		        percentile(histogram, 99) / 1000.0,
+		        histogram->max / 1000.0);
+	}
+}
+
+void
+latency_finalize(void)
+{
+	struct histogram *histogram, *next;
+
+	wl_list_for_each_safe (histogram, next, &histograms, link)
+		free(histogram);
+	wl_list_init(&histograms);
+}
@@ -0,0 +1,44 @@
+/* velox: latency.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_LATENCY_H
+#define VELOX_LATENCY_H
+
+#include <stdint.h>
+
+/* Latency from a binding firing to the last geometry or visibility change it
+ * caused being handed to swc, recorded per action identifier as bound, such
+ * as tag.1.activate. */
+
+void latency_begin(void);
+/* Called whenever a geometry or visibility change is handed to swc. */
+void latency_mark(void);
+/* The name must remain valid for the lifetime of the process. */
+void latency_end(const char *name);
+/* Record a latency in nanoseconds directly. */
+void latency_record(const char *name, uint64_t value);
+
+void latency_print(void);
+void latency_finalize(void);
+
+#endif
@@ -24,7 +24,9 @@
 #include "layout.h"
 #include "config.h"
 #include "screen.h"
+#include "stats.h"
 #include "velox.h"
+#include "watchdog.h"
 #include "window.h"
 
 #include <math.h>
@@ -35,8 +37,9 @@
 const unsigned master_max = 16;
 
 struct layout_impl {
+	const char *name;
 	void (*begin)(struct layout *layout, const struct swc_rectangle *area, unsigned num_windows);
-	void (*arrange)(struct layout *layout, struct window *window);
+	void (*arrange)(struct layout *layout, struct window_entry *entry);
 };
 
 struct col {
@@ -63,11 +66,24 @@ struct grid_layout {
 	struct grid grid;
 };
 
+static bool
+rectangle_equal(const struct swc_rectangle *a, const struct swc_rectangle *b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
 static void
-tile(struct col *col, struct window *window)
+tile(struct col *col, struct window_entry *entry)
 {
 	col->tile.y = col->area->y + border_width + col->row_index * col->area->height / col->num_rows;
-	swc_window_set_geometry(window->swc, &col->tile);
+
+	/* Most arrangements only move a few windows. */
+	if (!rectangle_equal(&col->tile, &entry->geometry)) {
+		swc_window_set_geometry(entry->window->swc, &col->tile);
+		entry->geometry = col->tile;
+		++stats[STAT_GEOMETRY];
+		watchdog_touch();
+	}
 
 	if (++col->row_index < col->num_rows)
 		return;
@@ -152,14 +168,15 @@ tall_begin(struct layout *base, const struct swc_rectangle *area, unsigned num_w
 }
 
 static void
-tall_arrange(struct layout *base, struct window *window)
+tall_arrange(struct layout *base, struct window_entry *entry)
 {
 	struct tall_layout *layout = (void *)base;
 
-	tile(&layout->grid.col, window);
+	tile(&layout->grid.col, entry);
 }
 
 static const struct layout_impl tall_impl = {
+	.name = "tall",
 	.begin = &tall_begin,
 	.arrange = &tall_arrange,
 };
@@ -201,14 +218,15 @@ grid_begin(struct layout *base, const struct swc_rectangle *area, unsigned num_w
 }
 
 static void
-grid_arrange(struct layout *base, struct window *window)
+grid_arrange(struct layout *base, struct window_entry *entry)
 {
 	struct grid_layout *layout = (void *)base;
 
-	tile(&layout->grid.col, window);
+	tile(&layout->grid.col, entry);
 }
 
 static const struct layout_impl grid_impl = {
+	.name = "grid",
 	.begin = &grid_begin,
 	.arrange = &grid_arrange,
 };
@@ -327,12 +345,13 @@ stack_begin(struct layout *layout, const struct swc_rectangle *area, unsigned nu
 }
 
 static void
-stack_arrange(struct layout *layout, struct window *window)
+stack_arrange(struct layout *layout, struct window_entry *entry)
 {
 	/* TODO: Place window on top of stack when swc adds support for this. */
 }
 
 static const struct layout_impl stack_impl = {
+	.name = "stack",
 	.begin = &stack_begin,
 	.arrange = &stack_arrange,
 };
@@ -372,6 +391,12 @@ layout_add_config_nodes(void)
 	wl_list_insert(config_root, &tall.config.group.link);
 }
 
+const char *
+layout_name(struct layout *layout)
+{
+	return layout->impl->name;
+}
+
 void
 layout_begin(struct layout *layout, const struct swc_rectangle *area, unsigned num_windows)
 {
@@ -379,7 +404,7 @@ layout_begin(struct layout *layout, const struct swc_rectangle *area, unsigned n
 }
 
 void
-layout_arrange(struct layout *layout, struct window *window)
+layout_arrange(struct layout *layout, struct window_entry *entry)
 {
-	layout->impl->arrange(layout, window);
+	layout->impl->arrange(layout, entry);
 }
@@ -27,7 +27,7 @@
 #include <wayland-server.h>
 
 struct screen;
-struct window;
+struct window_entry;
 struct swc_rectangle;
 
 enum layer {
@@ -49,7 +49,8 @@ struct layout *stack_layout_new(void);
 
 void layout_add_config_nodes(void);
 
+const char *layout_name(struct layout *layout);
 void layout_begin(struct layout *layout, const struct swc_rectangle *area, unsigned num_windows);
-void layout_arrange(struct layout *layout, struct window *window);
+void layout_arrange(struct layout *layout, struct window_entry *entry);
 
 #endif
@@ -0,0 +1,73 @@
+/* velox: pool.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pool.h"
+#include "stats.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+static bool
+grow(struct pool *pool)
+{
+	char *block, *object;
+	unsigned index;
+
+	/* Aligned to POOL_ALIGNMENT by malloc on the platforms we care about. */
+	if (!(block = malloc(pool->size * pool->block_length)))
+		return false;
+	++stats[STAT_ALLOCATIONS];
+
+	/* Thread the free list through the block in address order. */
+	for (index = pool->block_length; index > 0; --index) {
+		object = block + (index - 1) * pool->size;
+		*(void **)object = pool->free;
+		pool->free = object;
+	}
+	pool->capacity += pool->block_length;
+
+	return true;
+}
+
+void *
+pool_get(struct pool *pool)
+{
+	void *object;
+
+	if (!pool->free && !grow(pool))
+		return NULL;
+
+	object = pool->free;
+	pool->free = *(void **)object;
+	++pool->used;
+
+	return object;
+}
+
+void
+pool_put(struct pool *pool, void *object)
+{
+	*(void **)object = pool->free;
+	pool->free = object;
+	--pool->used;
+}
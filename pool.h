@@ -0,0 +1,54 @@
+/* velox: pool.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_POOL_H
+#define VELOX_POOL_H
+
+#include <stddef.h>
+
+/* Objects are aligned to this many bytes. */
+#define POOL_ALIGNMENT 16
+
+/**
+ * A pool of fixed-size objects. Objects are allocated from the heap in blocks
+ * and reused through a free list, so once a pool has grown to the number of
+ * objects in use at once, it no longer touches the heap. Blocks are never
+ * released.
+ */
+struct pool {
+	size_t size;
+	unsigned block_length;
+
+	void *free;
+	unsigned long used, capacity;
+};
+
+#define POOL_INITIALIZER(type, length) { \
+		.size = (sizeof(type) + POOL_ALIGNMENT - 1) & ~(size_t)(POOL_ALIGNMENT - 1), \
+		.block_length = length, \
+	}
+
+void *pool_get(struct pool *pool);
+void pool_put(struct pool *pool, void *object);
+
+#endif
@@ -0,0 +1,242 @@
+/* velox: record.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "record.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <swc.h>
+#include <wayland-util.h>
+
+struct object {
+	const void *pointer;
+	uint32_t id;
+};
+
+static struct {
+	FILE *file;
+	uint32_t start;
+	uint32_t next_id;
+	/* The screens and windows currently alive. There are rarely more than a
+	 * few dozen, so a linear search is fine. */
+	struct wl_array objects;
+} record;
+
+static struct object *
+find_object(const void *pointer)
+{
+	struct object *object;
+
+	wl_array_for_each (object, &record.objects) {
+		if (object->pointer == pointer)
+			return object;
+	}
+
+	return NULL;
+}
+
+static uint32_t
+object_id(const void *pointer)
+{
+	struct object *object;
+
+	if ((object = find_object(pointer)))
+		return object->id;
+	if (!(object = wl_array_add(&record.objects, sizeof(*object))))
+		return 0;
+	object->pointer = pointer;
+	object->id = ++record.next_id;
+
+	return object->id;
+}
+
+static void
+remove_object(const void *pointer)
+{
+	struct object *object, *last;
+
+	if (!(object = find_object(pointer)))
+		return;
+
+	last = (struct object *)((char *)record.objects.data + record.objects.size) - 1;
+	*object = *last;
+	record.objects.size -= sizeof(*object);
+}
+
+static void
+write_event(enum record_type type, uint32_t id, const void *payload, size_t length)
+{
+	struct record_event event = {
+		.type = type,
+		.length = length,
+		.time = get_time() - record.start,
+		.id = id,
+	};
+
+	fwrite(&event, sizeof(event), 1, record.file);
+	if (length)
+		fwrite(payload, length, 1, record.file);
+}
+
+static void
+write_string_event(enum record_type type, uint32_t id, const char *first, const char *second)
+{
+	char buffer[8192];
+	size_t length = 0, size;
+
+	if (!first)
+		first = "";
+	size = strnlen(first, sizeof(buffer) / 2 - 1);
+	memcpy(buffer, first, size);
+	buffer[size] = '\0';
+	length += size + 1;
+
+	if (second) {
+		size = strnlen(second, sizeof(buffer) / 2 - 1);
+		memcpy(buffer + length, second, size);
+		buffer[length + size] = '\0';
+		length += size + 1;
+	}
+
+	write_event(type, id, buffer, length);
+}
+
+static void
+copy_rectangle(struct record_rectangle *r, const struct swc_rectangle *geometry)
+{
+	r->x = geometry->x;
+	r->y = geometry->y;
+	r->width = geometry->width;
+	r->height = geometry->height;
+}
+
+bool
+record_initialize(void)
+{
+	struct record_header header = { RECORD_MAGIC, RECORD_VERSION };
+	const char *path;
+
+	if (!(path = getenv("VELOX_RECORD")))
+		return true;
+
+	if (!(record.file = fopen(path, "w"))) {
+		fprintf(stderr, "Could not open record file '%s'\n", path);
+		return false;
+	}
+
+	wl_array_init(&record.objects);
+	record.start = get_time();
+	fwrite(&header, sizeof(header), 1, record.file);
+
+	return true;
+}
+
+void
+record_finalize(void)
+{
+	if (!record.file)
+		return;
+
+	fclose(record.file);
+	record.file = NULL;
+	wl_array_release(&record.objects);
+}
+
+void
+record_screen_new(struct swc_screen *screen)
+{
+	struct record_rectangle geometry[2];
+
+	if (!record.file)
+		return;
+
+	copy_rectangle(&geometry[0], &screen->geometry);
+	copy_rectangle(&geometry[1], &screen->usable_geometry);
+	write_event(RECORD_SCREEN_NEW, object_id(screen), geometry, sizeof(geometry));
+}
+
+void
+record_screen_usable(struct swc_screen *screen)
+{
+	struct record_rectangle geometry;
+
+	if (!record.file)
+		return;
+
+	copy_rectangle(&geometry, &screen->usable_geometry);
+	write_event(RECORD_SCREEN_USABLE, object_id(screen), &geometry, sizeof(geometry));
+}
+
+void
+record_window_new(struct swc_window *window)
+{
+	if (!record.file)
+		return;
+
+	write_string_event(RECORD_WINDOW_NEW, object_id(window), window->app_id, window->title);
+}
+
+void
+record_window(enum record_type type, struct swc_window *window)
+{
+	if (!record.file)
+		return;
+
+	write_event(type, object_id(window), NULL, 0);
+	if (type == RECORD_WINDOW_DESTROY)
+		remove_object(window);
+}
+
+void
+record_window_title(struct swc_window *window)
+{
+	if (!record.file)
+		return;
+
+	write_string_event(RECORD_WINDOW_TITLE, object_id(window), window->title, NULL);
+}
+
+void
+record_window_parent(struct swc_window *window)
+{
+	uint32_t parent;
+
+	if (!record.file)
+		return;
+
+	parent = window->parent ? object_id(window->parent) : 0;
+	write_event(RECORD_WINDOW_PARENT, object_id(window), &parent, sizeof(parent));
+}
+
+void
+record_binding(uint32_t type, uint32_t modifiers, uint32_t value, uint32_t state)
+{
+	struct record_binding binding = { type, modifiers, value, state };
+
+	if (!record.file)
+		return;
+
+	write_event(RECORD_BINDING, 0, &binding, sizeof(binding));
+}
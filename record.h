@@ -0,0 +1,94 @@
+/* velox: record.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_RECORD_H
+#define VELOX_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct swc_screen;
+struct swc_window;
+
+/* When VELOX_RECORD names a file, everything swc tells us about is written to
+ * it in the format below, so that the session can be replayed against the
+ * headless build. */
+
+#define RECORD_MAGIC "VLXR"
+#define RECORD_VERSION 1
+
+enum record_type {
+	/* geometry and usable geometry, as struct record_rectangle */
+	RECORD_SCREEN_NEW = 1,
+	/* usable geometry */
+	RECORD_SCREEN_USABLE,
+	/* app_id and title, both nul-terminated */
+	RECORD_WINDOW_NEW,
+	/* title, nul-terminated */
+	RECORD_WINDOW_TITLE,
+	/* parent id, 0 for none */
+	RECORD_WINDOW_PARENT,
+	RECORD_WINDOW_ENTER,
+	RECORD_WINDOW_DESTROY,
+	/* struct record_binding */
+	RECORD_BINDING,
+};
+
+struct record_header {
+	char magic[4];
+	uint32_t version;
+};
+
+/* Each event is followed by length bytes of payload. Screens and windows are
+ * numbered from 1 in order of appearance. */
+struct record_event {
+	uint8_t type;
+	uint8_t pad;
+	uint16_t length;
+	/* milliseconds since recording began */
+	uint32_t time;
+	uint32_t id;
+};
+
+struct record_rectangle {
+	int32_t x, y;
+	uint32_t width, height;
+};
+
+struct record_binding {
+	uint32_t type, modifiers, value, state;
+};
+
+bool record_initialize(void);
+void record_finalize(void);
+
+void record_screen_new(struct swc_screen *screen);
+void record_screen_usable(struct swc_screen *screen);
+void record_window_new(struct swc_window *window);
+/* For the window events without any payload besides the window. */
+void record_window(enum record_type type, struct swc_window *window);
+void record_window_title(struct swc_window *window);
+void record_window_parent(struct swc_window *window);
+void record_binding(uint32_t type, uint32_t modifiers, uint32_t value, uint32_t state);
+
+#endif
@@ -22,7 +22,13 @@
  */
 
 #include "screen.h"
+#include "client.h"
+#include "latency.h"
 #include "layout.h"
+#include "record.h"
+#include "stats.h"
+#include "subscription.h"
+#include "trace.h"
 #include "util.h"
 #include "velox.h"
 #include "window.h"
@@ -30,7 +36,6 @@
 
 #include <assert.h>
 #include <stdlib.h>
-#include <string.h>
 #include <swc.h>
 
 static struct layout *(*default_layouts[])(void) = {
@@ -43,6 +48,7 @@ usable_geometry_changed(void *data)
 {
 	struct screen *screen = data;
 
+	record_screen_usable(screen->swc);
 	screen_arrange(screen);
 }
 
@@ -55,31 +61,22 @@ entered(void *data)
 	window_focus(screen->focus);
 }
 
+static int
+title_timeout(void *data)
+{
+	struct screen *screen = data;
+
+	if (screen->title_pending)
+		screen_focus_notify(screen);
+
+	return 0;
+}
+
 static const struct swc_screen_handler screen_handler = {
 	.usable_geometry_changed = &usable_geometry_changed,
 	.entered = &entered,
 };
 
-static void
-add_window(struct screen *screen, struct window *window)
-{
-	/* Remove the window from hidden window list and add it to the screen's list
-	 * of windows. */
-	wl_list_remove(&window->link);
-	wl_list_insert(screen->windows.prev, &window->link);
-	++screen->num_windows[window->layer];
-}
-
-static void
-remove_window(struct screen *screen, struct window *window)
-{
-	/* Remove the window from the screen's list of windows, and add it to the list
-	 * of hidden windows. */
-	wl_list_remove(&window->link);
-	wl_list_insert(velox.hidden_windows.prev, &window->link);
-	--screen->num_windows[window->layer];
-}
-
 static void
 send_focus(struct screen *screen, struct wl_resource *resource)
 {
@@ -88,18 +85,22 @@ send_focus(struct screen *screen, struct wl_resource *resource)
 
 	if (screen->focus) {
 		title = screen->focus->swc->title;
-		tag = wl_resource_find_for_client(&screen->focus->tag->resources, wl_resource_get_client(resource));
+		tag = client_tag(wl_resource_get_user_data(resource), screen->focus->tag);
 	} else {
 		title = NULL;
 		tag = NULL;
 	}
 
+	TRACE_INSTANT("velox_screen.focus");
 	velox_screen_send_focus(resource, title, tag);
+	client_sent(wl_resource_get_user_data(resource), CLIENT_VELOX_SCREEN,
+	            WIRE_HEADER + wire_string(title) + WIRE_WORD);
 }
 
 struct screen *
 screen_new(struct swc_screen *swc)
 {
+	static unsigned next_id;
 	struct screen *screen;
 	struct tag *tag;
 	struct layout *layout, *tmp;
@@ -118,22 +119,34 @@ screen_new(struct swc_screen *swc)
 	if (!(screen->layout[STACK] = stack_layout_new()))
 		goto error1;
 
+	screen->title_timer = wl_event_loop_add_timer(velox.event_loop, &title_timeout, screen);
+	if (!screen->title_timer)
+		goto error1;
+	if (!spatial_initialize(&screen->floating, &swc->geometry))
+		goto error2;
+	screen->last_notify = get_time() - title_interval;
+	screen->title_pending = false;
+
+	screen->id = next_id++;
 	wl_list_init(&screen->tags);
 	screen->mask = 0;
 	if ((tag = find_unused_tag()))
 		tag_set(tag, screen);
 	screen->last_mask = screen->mask;
 
-	wl_list_init(&screen->windows);
-	memset(screen->num_windows, 0, sizeof(screen->num_windows));
+	wl_array_init(&screen->windows);
 	screen->focus = NULL;
+	screen->fullscreen = NULL;
 
 	screen->swc = swc;
 	wl_list_init(&screen->resources);
 	swc_screen_set_handler(swc, &screen_handler, screen);
+	++stats[STAT_SCREENS];
 
 	return screen;
 
+error2:
+	wl_event_source_remove(screen->title_timer);
 error1:
 	wl_list_for_each_safe (layout, tmp, &screen->layouts, link)
 		free(layout);
@@ -144,108 +157,114 @@ error0:
 void
 screen_arrange(struct screen *screen)
 {
-	struct window *window;
+	struct window_entry *entry;
+	unsigned num_windows[NUM_LAYERS] = { 0 };
+
+	/* Nothing else on the screen is visible, and leaving fullscreen puts back
+	 * the geometry it had. */
+	if (screen->fullscreen)
+		return;
 
-	layout_begin(screen->layout[TILE], &screen->swc->usable_geometry, screen->num_windows[TILE]);
-	layout_begin(screen->layout[STACK], &screen->swc->usable_geometry, screen->num_windows[STACK]);
-	wl_list_for_each (window, &screen->windows, link)
-		layout_arrange(screen->layout[window->layer], window);
+	TRACE_BEGIN("screen_arrange");
+	++stats[STAT_ARRANGE];
+	wl_array_for_each (entry, &screen->windows)
+		++num_windows[entry->layer];
+	layout_begin(screen->layout[TILE], &screen->swc->usable_geometry, num_windows[TILE]);
+	layout_begin(screen->layout[STACK], &screen->swc->usable_geometry, num_windows[STACK]);
+	wl_array_for_each (entry, &screen->windows)
+		layout_arrange(screen->layout[entry->layer], entry);
+	latency_mark();
+	TRACE_END("screen_arrange");
+}
+
+/* Floating windows are added to and removed from the spatial index as they are
+ * placed, but when windows come and go in bulk, it is simpler to rebuild it. */
+static void
+index_floating(struct screen *screen)
+{
+	struct window_entry *entry;
+
+	spatial_clear(&screen->floating);
+	wl_array_for_each (entry, &screen->windows) {
+		if (entry->layer == STACK)
+			spatial_insert(&screen->floating, entry->window, &entry->geometry);
+	}
 }
 
 void
 screen_add_windows(struct screen *screen)
 {
-	struct window *window, *tmp;
+	unsigned count = window_count(&screen->windows);
 
-	wl_list_for_each_safe (window, tmp, &velox.hidden_windows, link) {
-		if (screen->mask & window->tag->mask) {
-			add_window(screen, window);
+	if (!window_transfer(&screen->windows, &velox.hidden_windows, screen->mask, true))
+		return;
+	if (window_count(&screen->windows) == count)
+		return;
 
-			if (!screen->focus)
-				screen_set_focus(screen, window);
-		}
-	}
+	index_floating(screen);
+	if (!screen->focus)
+		screen_set_focus(screen, window_entries(&screen->windows)[count].window);
 }
 
 void
 screen_remove_windows(struct screen *screen)
 {
-	struct window *window, *tmp;
+	struct window_entry *entries = window_entries(&screen->windows);
+	struct window *focus = screen->focus;
+	unsigned index, distance, count = window_count(&screen->windows);
+
+	/* Leave fullscreen first, so the new focus isn't held by a window that is
+	 * going away. */
+	if (screen->fullscreen && !(screen->mask & window_entry(screen->fullscreen)->mask))
+		window_set_fullscreen(screen->fullscreen, false);
 
 	/* If we will be removing the focus, try to find a new focus nearby the old
 	 * one. */
-	if (screen->focus && !(screen->focus->tag && screen->mask & screen->focus->tag->mask)) {
-		struct wl_list *forward = screen->focus->link.next, *backward = screen->focus->link.prev;
-
-		while (true) {
-			if (forward != &screen->windows) {
-				window = wl_container_of(forward, window, link);
-
-				if (screen->mask & window->tag->mask) {
-					screen_set_focus(screen, window);
-					break;
-				}
-
-				forward = forward->next;
+	if (focus && !(screen->mask & window_entry(focus)->mask)) {
+		index = focus->index;
+		focus = NULL;
+
+		for (distance = 1; distance < count; ++distance) {
+			if (index + distance < count && screen->mask & entries[index + distance].mask) {
+				focus = entries[index + distance].window;
+				break;
 			}
 
-			if (backward != &screen->windows) {
-				window = wl_container_of(backward, window, link);
-
-				if (screen->mask & window->tag->mask) {
-					screen_set_focus(screen, window);
-					break;
-				}
-
-				backward = backward->next;
+			if (distance <= index && screen->mask & entries[index - distance].mask) {
+				focus = entries[index - distance].window;
+				break;
 			}
-
-			/* If there is no suitable candidate for focus, we can just remove all the
-			 * windows and set the focus to NULL. */
-			screen_set_focus(screen, NULL);
-			wl_list_insert_list(&velox.hidden_windows, &screen->windows);
-			wl_list_init(&screen->windows);
-			memset(screen->num_windows, 0, sizeof(screen->num_windows));
-			return;
 		}
-	}
 
-	wl_list_for_each_safe (window, tmp, &screen->windows, link) {
-		if (!(window->tag && screen->mask & window->tag->mask))
-			remove_window(screen, window);
+		screen_set_focus(screen, focus);
 	}
+
+	window_transfer(&velox.hidden_windows, &screen->windows, screen->mask, false);
+	if (window_count(&screen->windows) != count)
+		index_floating(screen);
 }
 
 void
 screen_focus_next(struct screen *screen)
 {
-	struct wl_list *link;
+	struct window_entry *entries = window_entries(&screen->windows);
 
 	if (!screen->focus)
 		return;
 
-	link = screen->focus->link.next;
-
-	if (link == &screen->windows)
-		link = link->next;
-
-	screen_set_focus(screen, wl_container_of(link, screen->focus, link));
+	screen_set_focus(screen, entries[(screen->focus->index + 1) % window_count(&screen->windows)].window);
 }
 
 void
 screen_focus_prev(struct screen *screen)
 {
-	struct wl_list *link;
+	struct window_entry *entries = window_entries(&screen->windows);
+	unsigned count = window_count(&screen->windows);
 
 	if (!screen->focus)
 		return;
 
-	link = screen->focus->link.prev;
-
-	if (link == &screen->windows)
-		link = link->prev;
-
-	screen_set_focus(screen, wl_container_of(link, screen->focus, link));
+	screen_set_focus(screen, entries[(screen->focus->index + count - 1) % count].window);
 }
 
 void
@@ -254,6 +273,11 @@ screen_set_focus(struct screen *screen, struct window *window)
 	if (window)
 		assert(window->tag->screen == screen);
 
+	/* Everything else on the screen is hidden behind a fullscreen window, so
+	 * the focus stays with it. */
+	if (screen->fullscreen)
+		window = screen->fullscreen;
+
 	screen->focus = window;
 	screen_focus_notify(screen);
 
@@ -271,6 +295,7 @@ screen_set_tags(struct screen *screen, uint32_t mask)
 	if (screen->mask == mask)
 		return;
 
+	TRACE_BEGIN("screen_set_tags");
 	while ((tag = next_tag(&removed)))
 		tag_set(tag, NULL);
 	screen_remove_windows(screen);
@@ -294,25 +319,33 @@ screen_set_tags(struct screen *screen, uint32_t mask)
 	while ((tag = next_tag(&added)))
 		tag_add(tag, screen);
 	screen_add_windows(screen);
+	TRACE_END("screen_set_tags");
 }
 
 struct wl_resource *
 screen_bind(struct screen *screen, struct wl_client *client, uint32_t id)
 {
+	struct client *record;
 	struct wl_resource *resource;
 	struct tag *tag;
 
+	if (!(record = client_get(client)))
+		return NULL;
+
 	resource = wl_resource_create(client, &velox_screen_interface, 1, id);
 
 	if (!resource)
 		return NULL;
 
-	wl_list_insert(&screen->resources, wl_resource_get_link(resource));
-	wl_resource_set_destructor(resource, &remove_resource);
+	if (!client_add_screen(record, screen, resource)) {
+		wl_resource_destroy(resource);
+		return NULL;
+	}
+
 	send_focus(screen, resource);
 
 	wl_list_for_each (tag, &screen->tags, link)
-		tag_send_screen(tag, client, NULL, resource);
+		tag_send_screen(tag, record, NULL, resource);
 
 	return resource;
 }
@@ -324,4 +357,30 @@ screen_focus_notify(struct screen *screen)
 
 	wl_resource_for_each (resource, &screen->resources)
 		send_focus(screen, resource);
+	subscription_notify_focus(screen);
+
+	screen->last_notify = get_time();
+	if (screen->title_pending) {
+		screen->title_pending = false;
+		wl_event_source_timer_update(screen->title_timer, 0);
+	}
+}
+
+void
+screen_title_changed(struct screen *screen)
+{
+	uint32_t elapsed;
+
+	/* The pending notification will pick up this title. */
+	if (screen->title_pending)
+		return;
+
+	elapsed = get_time() - screen->last_notify;
+	if (elapsed >= title_interval) {
+		screen_focus_notify(screen);
+		return;
+	}
+
+	screen->title_pending = true;
+	wl_event_source_timer_update(screen->title_timer, title_interval - elapsed);
 }
@@ -26,6 +26,7 @@
 
 #include "tag.h"
 #include "layout.h"
+#include "spatial.h"
 
 #include <wayland-server.h>
 
@@ -38,6 +39,7 @@ struct view {
 struct screen {
 	struct swc_screen *swc;
 	struct wl_list link;
+	unsigned id;
 
 	struct wl_list tags;
 	uint32_t mask, last_mask;
@@ -45,11 +47,22 @@ struct screen {
 	struct wl_list layouts;
 	struct layout *layout[NUM_LAYERS];
 
-	struct wl_list windows;
-	unsigned num_windows[NUM_LAYERS];
+	/* Entries of the windows shown on this screen, see window.h. */
+	struct wl_array windows;
 	struct window *focus;
+	/* While a window is fullscreen, the rest of the screen is hidden and not
+	 * arranged. */
+	struct window *fullscreen;
+	/* Stacked windows whose geometry was set by velox. */
+	struct spatial floating;
 
 	struct wl_list resources;
+
+	/* Focus notifications due to title changes are rate-limited to one per
+	 * title_interval milliseconds. */
+	struct wl_event_source *title_timer;
+	uint32_t last_notify;
+	bool title_pending;
 };
 
 struct screen *screen_new(struct swc_screen *swc);
@@ -68,4 +81,13 @@ void screen_remove_windows(struct screen *screen);
 struct wl_resource *screen_bind(struct screen *screen, struct wl_client *client, uint32_t id);
 void screen_focus_notify(struct screen *screen);
 
+/**
+ * Notify clients of a change to the title of the screen's focus.
+ *
+ * If clients were notified less than title_interval milliseconds ago, the
+ * notification is deferred until the end of the interval, and then sends the
+ * title current at that time.
+ */
+void screen_title_changed(struct screen *screen);
+
 #endif
@@ -0,0 +1,215 @@
+/* velox: spatial.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "spatial.h"
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct range {
+	unsigned x1, y1, x2, y2;
+};
+
+static unsigned
+clamp(int64_t value, unsigned length)
+{
+	if (value < 0)
+		return 0;
+	if (value >= length)
+		return length - 1;
+	return value;
+}
+
+static unsigned
+column(struct spatial *index, int64_t x)
+{
+	return clamp((x - index->area.x) / SPATIAL_CELL_SIZE, index->columns);
+}
+
+static unsigned
+row(struct spatial *index, int64_t y)
+{
+	return clamp((y - index->area.y) / SPATIAL_CELL_SIZE, index->rows);
+}
+
+static bool
+cells(struct spatial *index, const struct swc_rectangle *r, struct range *range)
+{
+	if (r->width == 0 || r->height == 0)
+		return false;
+
+	range->x1 = column(index, r->x);
+	range->y1 = row(index, r->y);
+	range->x2 = column(index, (int64_t)r->x + r->width - 1);
+	range->y2 = row(index, (int64_t)r->y + r->height - 1);
+
+	return true;
+}
+
+static bool
+intersects(const struct swc_rectangle *a, const struct swc_rectangle *b)
+{
+	return (int64_t)a->x < (int64_t)b->x + b->width && (int64_t)b->x < (int64_t)a->x + a->width
+	    && (int64_t)a->y < (int64_t)b->y + b->height && (int64_t)b->y < (int64_t)a->y + a->height;
+}
+
+bool
+spatial_initialize(struct spatial *index, const struct swc_rectangle *area)
+{
+	index->area = *area;
+	index->columns = (area->width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	index->rows = (area->height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	if (index->columns == 0)
+		index->columns = 1;
+	if (index->rows == 0)
+		index->rows = 1;
+
+	/* Zeroed arrays are empty. */
+	if (!(index->cells = calloc(index->columns * index->rows, sizeof(*index->cells))))
+		return false;
+	++stats[STAT_ALLOCATIONS];
+
+	return true;
+}
+
+void
+spatial_finalize(struct spatial *index)
+{
+	unsigned cell;
+
+	for (cell = 0; cell < index->columns * index->rows; ++cell)
+		wl_array_release(&index->cells[cell]);
+	free(index->cells);
+}
+
+void
+spatial_clear(struct spatial *index)
+{
+	unsigned cell;
+
+	for (cell = 0; cell < index->columns * index->rows; ++cell)
+		index->cells[cell].size = 0;
+}
+
+bool
+spatial_insert(struct spatial *index, struct window *window, const struct swc_rectangle *geometry)
+{
+	struct spatial_item *item;
+	struct range range;
+	unsigned x, y;
+
+	if (!cells(index, geometry, &range))
+		return true;
+
+	for (y = range.y1; y <= range.y2; ++y) {
+		for (x = range.x1; x <= range.x2; ++x) {
+			if (!(item = wl_array_add(&index->cells[y * index->columns + x], sizeof(*item))))
+				goto error;
+			item->window = window;
+			item->geometry = *geometry;
+		}
+	}
+
+	return true;
+
+error:
+	/* Take out the items added so far, including the cell that failed. */
+	spatial_remove(index, window, geometry);
+	return false;
+}
+
+void
+spatial_remove(struct spatial *index, struct window *window, const struct swc_rectangle *geometry)
+{
+	struct wl_array *cell;
+	struct spatial_item *item;
+	struct range range;
+	unsigned x, y;
+
+	if (!cells(index, geometry, &range))
+		return;
+
+	for (y = range.y1; y <= range.y2; ++y) {
+		for (x = range.x1; x <= range.x2; ++x) {
+			cell = &index->cells[y * index->columns + x];
+			wl_array_for_each (item, cell) {
+				if (item->window == window) {
+					/* Keep the insertion order for spatial_at. */
+					memmove(item, item + 1, (char *)cell->data + cell->size - (char *)(item + 1));
+					cell->size -= sizeof(*item);
+					break;
+				}
+			}
+		}
+	}
+}
+
+struct window *
+spatial_at(struct spatial *index, int32_t x, int32_t y)
+{
+	struct wl_array *cell = &index->cells[row(index, y) * index->columns + column(index, x)];
+	struct spatial_item *items = cell->data;
+	const struct swc_rectangle point = { .x = x, .y = y, .width = 1, .height = 1 };
+	size_t i;
+
+	for (i = cell->size / sizeof(*items); i > 0; --i) {
+		++stats[STAT_SPATIAL_VISITS];
+		if (intersects(&items[i - 1].geometry, &point))
+			return items[i - 1].window;
+	}
+
+	return NULL;
+}
+
+void
+spatial_query(struct spatial *index, const struct swc_rectangle *rectangle,
+              void (*func)(const struct spatial_item *item, void *data), void *data)
+{
+	struct spatial_item *item;
+	struct range range;
+	unsigned x, y;
+
+	if (!cells(index, rectangle, &range))
+		return;
+
+	for (y = range.y1; y <= range.y2; ++y) {
+		for (x = range.x1; x <= range.x2; ++x) {
+			wl_array_for_each (item, &index->cells[y * index->columns + x]) {
+				++stats[STAT_SPATIAL_VISITS];
+				if (!intersects(&item->geometry, rectangle))
+					continue;
+
+				/* A window spanning several cells is reported only from the cell
+				 * holding the top-left corner of its intersection with the
+				 * rectangle. */
+				if (column(index, item->geometry.x > rectangle->x ? item->geometry.x : rectangle->x) != x
+				    || row(index, item->geometry.y > rectangle->y ? item->geometry.y : rectangle->y) != y)
+					continue;
+
+				++stats[STAT_SPATIAL_MATCHES];
+				func(item, data);
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+/* velox: spatial.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_SPATIAL_H
+#define VELOX_SPATIAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <swc.h>
+#include <wayland-util.h>
+
+struct window;
+
+/* The side of the square cells of the grid, in pixels. */
+#define SPATIAL_CELL_SIZE 256
+
+struct spatial_item {
+	struct window *window;
+	struct swc_rectangle geometry;
+};
+
+/**
+ * A uniform grid over an area, indexing window rectangles by the cells they
+ * overlap. Rectangles reaching outside the area are clamped to the border
+ * cells.
+ */
+struct spatial {
+	struct swc_rectangle area;
+	unsigned columns, rows;
+	/* Arrays of struct spatial_item, most recently inserted last. */
+	struct wl_array *cells;
+};
+
+bool spatial_initialize(struct spatial *index, const struct swc_rectangle *area);
+void spatial_finalize(struct spatial *index);
+void spatial_clear(struct spatial *index);
+
+bool spatial_insert(struct spatial *index, struct window *window, const struct swc_rectangle *geometry);
+/* The geometry must be the one the window was inserted with. */
+void spatial_remove(struct spatial *index, struct window *window, const struct swc_rectangle *geometry);
+
+/* The most recently inserted window containing the point, or NULL. */
+struct window *spatial_at(struct spatial *index, int32_t x, int32_t y);
+/* Call the function once for every window intersecting the rectangle. */
+void spatial_query(struct spatial *index, const struct swc_rectangle *rectangle,
+                   void (*func)(const struct spatial_item *item, void *data), void *data);
+
+#endif
@@ -0,0 +1,148 @@
+/* velox: stats.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "stats.h"
+#include "client.h"
+#include "trace.h"
+#include "protocol/velox-server-protocol.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <wayland-server.h>
+
+uint64_t stats[NUM_STATS];
+
+static const char *const names[NUM_STATS] = {
+	[STAT_ARRANGE] = "arrange",
+	[STAT_GEOMETRY] = "geometry",
+	[STAT_SHOW] = "show",
+	[STAT_HIDE] = "hide",
+	[STAT_FOCUS] = "focus",
+	[STAT_EVENTS_SCREEN] = "events.velox_screen",
+	[STAT_EVENTS_TAG] = "events.velox_tag",
+	[STAT_EVENTS_SUBSCRIPTION] = "events.velox_subscription",
+	[STAT_EVENTS_STATS] = "events.velox_stats",
+	[STAT_RULES_EVALUATED] = "rules.evaluated",
+	[STAT_RULES_MATCHED] = "rules.matched",
+	[STAT_SPAWNS] = "spawns",
+	[STAT_ALLOCATIONS] = "allocations",
+	[STAT_WINDOWS] = "windows",
+	[STAT_SCREENS] = "screens",
+	[STAT_RESOURCES] = "resources",
+	[STAT_SPATIAL_VISITS] = "spatial.visits",
+	[STAT_SPATIAL_MATCHES] = "spatial.matches",
+};
+
+static void
+destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+send_counter(struct wl_resource *resource, const char *name, uint64_t value)
+{
+	velox_stats_send_counter(resource, name, value >> 32, value & 0xffffffff);
+	client_sent(wl_resource_get_user_data(resource), CLIENT_VELOX_STATS,
+	            WIRE_HEADER + wire_string(name) + 2 * WIRE_WORD);
+}
+
+/* Per-client counters are named client.<id>.<interface>.<counter>, with the id
+ * of the client's record, since a pid can be reused once a client exits. */
+static void
+send_client_counters(struct wl_resource *resource, struct client *client)
+{
+	char name[64];
+	const char *interface;
+	unsigned index;
+	pid_t pid;
+
+	wl_client_get_credentials(client->client, &pid, NULL, NULL);
+	snprintf(name, sizeof(name), "client.%u.pid", client->id);
+	send_counter(resource, name, pid);
+	for (index = 0; index < NUM_CLIENT_INTERFACES; ++index) {
+		interface = client_interface_name(index);
+		snprintf(name, sizeof(name), "client.%u.%s.resources", client->id, interface);
+		send_counter(resource, name, client->interfaces[index].resources);
+		snprintf(name, sizeof(name), "client.%u.%s.events", client->id, interface);
+		send_counter(resource, name, client->interfaces[index].events);
+		snprintf(name, sizeof(name), "client.%u.%s.bytes", client->id, interface);
+		send_counter(resource, name, client->interfaces[index].bytes);
+	}
+	snprintf(name, sizeof(name), "client.%u.max_queued", client->id);
+	send_counter(resource, name, client->max_queued);
+}
+
+static void
+sample(struct wl_client *client, struct wl_resource *resource)
+{
+	uint64_t values[NUM_STATS];
+	struct client *record;
+	unsigned index;
+
+	TRACE_INSTANT("velox_stats.sample");
+
+	/* Take a snapshot first, so that the events we send here aren't counted
+	 * part way through. */
+	memcpy(values, stats, sizeof(values));
+	for (index = 0; index < NUM_STATS; ++index)
+		send_counter(resource, names[index], values[index]);
+	wl_list_for_each (record, &clients, link)
+		send_client_counters(resource, record);
+	velox_stats_send_done(resource);
+	client_sent(wl_resource_get_user_data(resource), CLIENT_VELOX_STATS, WIRE_HEADER);
+}
+
+static const struct velox_stats_interface stats_implementation = {
+	.destroy = &destroy,
+	.sample = &sample,
+};
+
+static void
+destroy_resource(struct wl_resource *resource)
+{
+	client_remove_resource(wl_resource_get_user_data(resource), CLIENT_VELOX_STATS);
+}
+
+bool
+stats_new(struct wl_client *client, uint32_t id)
+{
+	struct wl_resource *resource;
+	struct client *record;
+
+	if (!(record = client_get(client)))
+		return false;
+	if (!(resource = wl_resource_create(client, &velox_stats_interface, 1, id)))
+		return false;
+
+	wl_resource_set_implementation(resource, &stats_implementation, record, &destroy_resource);
+	client_add_resource(record, CLIENT_VELOX_STATS);
+
+	return true;
+}
+
+const char *
+stats_name(enum stat_counter counter)
+{
+	return names[counter];
+}
@@ -0,0 +1,59 @@
+/* velox: stats.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_STATS_H
+#define VELOX_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct wl_client;
+
+enum stat_counter {
+	STAT_ARRANGE,
+	STAT_GEOMETRY,
+	STAT_SHOW,
+	STAT_HIDE,
+	STAT_FOCUS,
+	STAT_EVENTS_SCREEN,
+	STAT_EVENTS_TAG,
+	STAT_EVENTS_SUBSCRIPTION,
+	STAT_EVENTS_STATS,
+	STAT_RULES_EVALUATED,
+	STAT_RULES_MATCHED,
+	STAT_SPAWNS,
+	STAT_ALLOCATIONS,
+	STAT_WINDOWS,
+	STAT_SCREENS,
+	STAT_RESOURCES,
+	STAT_SPATIAL_VISITS,
+	STAT_SPATIAL_MATCHES,
+	NUM_STATS
+};
+
+extern uint64_t stats[NUM_STATS];
+
+bool stats_new(struct wl_client *client, uint32_t id);
+const char *stats_name(enum stat_counter counter);
+
+#endif
@@ -0,0 +1,389 @@
+/* velox: subscription.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "subscription.h"
+#include "client.h"
+#include "layout.h"
+#include "screen.h"
+#include "tag.h"
+#include "trace.h"
+#include "velox.h"
+#include "window.h"
+#include "protocol/velox-server-protocol.h"
+
+#include <stdlib.h>
+#include <strings.h>
+#include <swc.h>
+#include <wayland-server.h>
+
+#define QUEUE_SIZE 32
+
+struct event {
+	uint32_t class;
+	union {
+		struct screen *screen;
+		struct tag *tag;
+		struct {
+			uint32_t id;
+			int32_t tag;
+			uint32_t layer;
+		} window;
+	};
+};
+
+struct subscription {
+	struct wl_resource *resource;
+	struct client *client;
+	struct wl_list link;
+	uint32_t classes;
+
+	/* Changes not yet sent to the client, coalesced by object. */
+	struct event queue[QUEUE_SIZE];
+	unsigned length;
+	bool resync;
+
+	/* The serial of the batch awaiting acknowledgement, or 0 if the client is
+	 * ready for another batch. */
+	uint32_t pending_serial, next_serial;
+	uint32_t dropped;
+};
+
+static struct wl_list subscriptions = { &subscriptions, &subscriptions };
+static struct wl_event_source *flush_source;
+
+static int32_t
+tag_index(struct tag *tag)
+{
+	return tag ? ffs(tag->mask) - 1 : -1;
+}
+
+static void
+window_event(struct event *event, struct window *window)
+{
+	event->class = VELOX_SUBSCRIPTION_CLASS_WINDOW;
+	event->window.id = window->id;
+	event->window.tag = tag_index(window->tag);
+	event->window.layer = window->layer;
+}
+
+static void
+send_event(struct subscription *subscription, const struct event *event)
+{
+	struct wl_resource *resource = subscription->resource;
+	struct screen *screen = event->screen;
+	struct tag *tag = event->tag;
+	const char *string;
+	size_t size;
+
+	switch (event->class) {
+	case VELOX_SUBSCRIPTION_CLASS_FOCUS:
+		TRACE_INSTANT("velox_subscription.focus");
+		string = screen->focus ? screen->focus->swc->title : NULL;
+		velox_subscription_send_focus(resource, screen->id,
+		                              screen->focus ? tag_index(screen->focus->tag) : -1, string);
+		size = 2 * WIRE_WORD + wire_string(string);
+		break;
+	case VELOX_SUBSCRIPTION_CLASS_TAG:
+		TRACE_INSTANT("velox_subscription.tag");
+		velox_subscription_send_tag(resource, tag_index(tag), tag->name,
+		                            tag->screen ? tag->screen->id : -1, tag->num_windows);
+		size = 3 * WIRE_WORD + wire_string(tag->name);
+		break;
+	case VELOX_SUBSCRIPTION_CLASS_WINDOW:
+		TRACE_INSTANT("velox_subscription.window");
+		velox_subscription_send_window(resource, event->window.id, event->window.tag, event->window.layer);
+		size = 3 * WIRE_WORD;
+		break;
+	case VELOX_SUBSCRIPTION_CLASS_LAYOUT:
+		TRACE_INSTANT("velox_subscription.layout");
+		string = layout_name(screen->layout[TILE]);
+		velox_subscription_send_layout(resource, screen->id, string);
+		size = WIRE_WORD + wire_string(string);
+		break;
+	default:
+		return;
+	}
+	client_sent(subscription->client, CLIENT_VELOX_SUBSCRIPTION, WIRE_HEADER + size);
+}
+
+static void
+send_state(struct subscription *subscription)
+{
+	struct screen *screen;
+	struct window_entry *entry;
+	struct event event;
+	unsigned index;
+
+	TRACE_INSTANT("velox_subscription.resync");
+	velox_subscription_send_resync(subscription->resource);
+	client_sent(subscription->client, CLIENT_VELOX_SUBSCRIPTION, WIRE_HEADER);
+
+	wl_list_for_each (screen, &velox.screens, link) {
+		event.screen = screen;
+		if (subscription->classes & VELOX_SUBSCRIPTION_CLASS_FOCUS) {
+			event.class = VELOX_SUBSCRIPTION_CLASS_FOCUS;
+			send_event(subscription, &event);
+		}
+		if (subscription->classes & VELOX_SUBSCRIPTION_CLASS_LAYOUT) {
+			event.class = VELOX_SUBSCRIPTION_CLASS_LAYOUT;
+			send_event(subscription, &event);
+		}
+		if (subscription->classes & VELOX_SUBSCRIPTION_CLASS_WINDOW) {
+			wl_array_for_each (entry, &screen->windows) {
+				window_event(&event, entry->window);
+				send_event(subscription, &event);
+			}
+		}
+	}
+
+	if (subscription->classes & VELOX_SUBSCRIPTION_CLASS_TAG) {
+		event.class = VELOX_SUBSCRIPTION_CLASS_TAG;
+		for (index = 0; index < NUM_TAGS; ++index) {
+			event.tag = velox.tags[index];
+			send_event(subscription, &event);
+		}
+	}
+
+	if (subscription->classes & VELOX_SUBSCRIPTION_CLASS_WINDOW) {
+		wl_array_for_each (entry, &velox.hidden_windows) {
+			window_event(&event, entry->window);
+			send_event(subscription, &event);
+		}
+	}
+}
+
+static void
+flush(struct subscription *subscription)
+{
+	unsigned index;
+
+	if (subscription->pending_serial != 0)
+		return;
+	if (!subscription->resync && subscription->length == 0)
+		return;
+
+	if (subscription->resync) {
+		send_state(subscription);
+	} else {
+		for (index = 0; index < subscription->length; ++index)
+			send_event(subscription, &subscription->queue[index]);
+	}
+
+	subscription->length = 0;
+	subscription->resync = false;
+
+	if (++subscription->next_serial == 0)
+		++subscription->next_serial;
+	subscription->pending_serial = subscription->next_serial;
+	TRACE_INSTANT("velox_subscription.done");
+	velox_subscription_send_done(subscription->resource, subscription->pending_serial);
+	client_sent(subscription->client, CLIENT_VELOX_SUBSCRIPTION, WIRE_HEADER + WIRE_WORD);
+}
+
+static void
+flush_all(void *data)
+{
+	struct subscription *subscription;
+
+	flush_source = NULL;
+	wl_list_for_each (subscription, &subscriptions, link)
+		flush(subscription);
+}
+
+static void
+schedule_flush(void)
+{
+	if (!flush_source)
+		flush_source = wl_event_loop_add_idle(velox.event_loop, &flush_all, NULL);
+}
+
+static bool
+same_object(const struct event *a, const struct event *b)
+{
+	if (a->class != b->class)
+		return false;
+
+	switch (a->class) {
+	case VELOX_SUBSCRIPTION_CLASS_TAG:
+		return a->tag == b->tag;
+	case VELOX_SUBSCRIPTION_CLASS_WINDOW:
+		return a->window.id == b->window.id;
+	default:
+		return a->screen == b->screen;
+	}
+}
+
+static void
+push(struct subscription *subscription, const struct event *event)
+{
+	unsigned index;
+
+	/* The full state will be sent anyway. */
+	if (subscription->resync) {
+		++subscription->dropped;
+		return;
+	}
+
+	for (index = 0; index < subscription->length; ++index) {
+		if (same_object(&subscription->queue[index], event)) {
+			subscription->queue[index] = *event;
+			return;
+		}
+	}
+
+	/* The client has fallen too far behind, so collapse everything it has
+	 * missed into a resync. */
+	if (subscription->length == QUEUE_SIZE) {
+		subscription->dropped += subscription->length + 1;
+		subscription->length = 0;
+		subscription->resync = true;
+		return;
+	}
+
+	subscription->queue[subscription->length++] = *event;
+}
+
+static void
+notify(const struct event *event)
+{
+	struct subscription *subscription;
+	bool queued = false;
+
+	wl_list_for_each (subscription, &subscriptions, link) {
+		if (subscription->classes & event->class) {
+			push(subscription, event);
+			queued = true;
+		}
+	}
+
+	if (queued)
+		schedule_flush();
+}
+
+void
+subscription_notify_focus(struct screen *screen)
+{
+	notify(&(struct event){ .class = VELOX_SUBSCRIPTION_CLASS_FOCUS, .screen = screen });
+}
+
+void
+subscription_notify_tag(struct tag *tag)
+{
+	notify(&(struct event){ .class = VELOX_SUBSCRIPTION_CLASS_TAG, .tag = tag });
+}
+
+void
+subscription_notify_window(struct window *window)
+{
+	struct event event;
+
+	window_event(&event, window);
+	notify(&event);
+}
+
+void
+subscription_notify_layout(struct screen *screen)
+{
+	notify(&(struct event){ .class = VELOX_SUBSCRIPTION_CLASS_LAYOUT, .screen = screen });
+}
+
+static void
+destroy_subscription(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+ack(struct wl_client *client, struct wl_resource *resource, uint32_t serial)
+{
+	struct subscription *subscription = wl_resource_get_user_data(resource);
+
+	if (serial != subscription->pending_serial)
+		return;
+
+	subscription->pending_serial = 0;
+	flush(subscription);
+}
+
+static void
+get_stats(struct wl_client *client, struct wl_resource *resource)
+{
+	struct subscription *subscription = wl_resource_get_user_data(resource);
+
+	TRACE_INSTANT("velox_subscription.stats");
+	velox_subscription_send_stats(resource, subscription->length, subscription->dropped);
+	client_sent(subscription->client, CLIENT_VELOX_SUBSCRIPTION, WIRE_HEADER + 2 * WIRE_WORD);
+}
+
+static const struct velox_subscription_interface subscription_implementation = {
+	.destroy = &destroy_subscription,
+	.ack = &ack,
+	.get_stats = &get_stats,
+};
+
+static void
+destroy_resource(struct wl_resource *resource)
+{
+	struct subscription *subscription = wl_resource_get_user_data(resource);
+
+	wl_list_remove(&subscription->link);
+	client_remove_resource(subscription->client, CLIENT_VELOX_SUBSCRIPTION);
+	free(subscription);
+}
+
+bool
+subscription_new(struct wl_client *client, uint32_t id, uint32_t classes)
+{
+	struct subscription *subscription;
+
+	if (!(subscription = malloc(sizeof(*subscription))))
+		goto error0;
+
+	if (!(subscription->client = client_get(client)))
+		goto error1;
+
+	subscription->resource = wl_resource_create(client, &velox_subscription_interface, 1, id);
+	if (!subscription->resource)
+		goto error1;
+
+	wl_resource_set_implementation(subscription->resource, &subscription_implementation,
+	                               subscription, &destroy_resource);
+	subscription->classes = classes;
+	subscription->length = 0;
+	subscription->pending_serial = 0;
+	subscription->next_serial = 0;
+	subscription->dropped = 0;
+
+	/* Start the client off with the complete state. */
+	subscription->resync = true;
+	wl_list_insert(&subscriptions, &subscription->link);
+	client_add_resource(subscription->client, CLIENT_VELOX_SUBSCRIPTION);
+	schedule_flush();
+
+	return true;
+
+error1:
+	free(subscription);
+error0:
+	return false;
+}
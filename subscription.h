@@ -0,0 +1,48 @@
+/* velox: subscription.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_SUBSCRIPTION_H
+#define VELOX_SUBSCRIPTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct screen;
+struct tag;
+struct window;
+struct wl_client;
+
+bool subscription_new(struct wl_client *client, uint32_t id, uint32_t classes);
+
+/**
+ * Queue a change for all subscribers of the corresponding event class.
+ *
+ * Focus, tag and layout events carry the state at the time they are sent, so
+ * repeated changes to the same object only occupy a single queue entry.
+ */
+void subscription_notify_focus(struct screen *screen);
+void subscription_notify_tag(struct tag *tag);
+void subscription_notify_window(struct window *window);
+void subscription_notify_layout(struct screen *screen);
+
+#endif
@@ -22,8 +22,12 @@
  */
 
 #include "tag.h"
+#include "client.h"
+#include "intern.h"
 #include "layout.h"
 #include "screen.h"
+#include "subscription.h"
+#include "trace.h"
 #include "util.h"
 #include "velox.h"
 #include "window.h"
@@ -48,16 +52,20 @@ set_name(struct config_node *node, const char *value)
 {
 	struct tag *tag = wl_container_of(node, tag, config.name);
 	struct wl_resource *resource;
-	char *name;
+	const char *name;
 
-	if (!(name = strdup(value)))
+	if (!(name = intern(value)))
 		return false;
 
-	free(tag->name);
 	tag->name = name;
 
-	wl_resource_for_each (resource, &tag->resources)
+	wl_resource_for_each (resource, &tag->resources) {
+		TRACE_INSTANT("velox_tag.name");
 		velox_tag_send_name(resource, tag->name);
+		client_sent(wl_resource_get_user_data(resource), CLIENT_VELOX_TAG,
+		            WIRE_HEADER + wire_string(tag->name));
+	}
+	subscription_notify_tag(tag);
 
 	return true;
 }
@@ -96,27 +104,40 @@ apply(struct config_node *node, const struct variant *v)
 	update();
 }
 
-static void
-bind_tag(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+struct wl_resource *
+tag_bind(struct tag *tag, struct wl_client *client, uint32_t version, uint32_t id)
 {
-	struct tag *tag = data;
+	struct client *record;
 	struct wl_resource *resource;
 
-	if (version >= 1)
-		version = 1;
+	if (!(record = client_get(client)))
+		return NULL;
 
 	resource = wl_resource_create(client, &velox_tag_interface, version, id);
 
-	if (!resource) {
-		wl_client_post_no_memory(client);
-		return;
-	}
+	if (!resource)
+		return NULL;
 
-	wl_resource_set_destructor(resource, &remove_resource);
-	wl_list_insert(&tag->resources, wl_resource_get_link(resource));
+	client_add_tag(record, tag, resource);
+	TRACE_INSTANT("velox_tag.name");
 	velox_tag_send_name(resource, tag->name);
+	client_sent(record, CLIENT_VELOX_TAG, WIRE_HEADER + wire_string(tag->name));
+	TRACE_INSTANT("velox_tag.state");
 	velox_tag_send_state(resource, tag->num_windows);
-	tag_send_screen(tag, client, resource, NULL);
+	client_sent(record, CLIENT_VELOX_TAG, WIRE_HEADER + WIRE_WORD);
+	tag_send_screen(tag, record, resource, NULL);
+
+	return resource;
+}
+
+static void
+bind_tag(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	if (version >= 1)
+		version = 1;
+
+	if (!tag_bind(data, client, version, id))
+		wl_client_post_no_memory(client);
 }
 
 struct tag *
@@ -127,7 +148,7 @@ tag_new(unsigned index, const char *name)
 	if (!(tag = malloc(sizeof *tag)))
 		goto error0;
 
-	if (!(tag->name = strdup(name)))
+	if (!(tag->name = intern(name)))
 		goto error1;
 
 	tag->mask = TAG_MASK(index);
@@ -136,9 +157,9 @@ tag_new(unsigned index, const char *name)
 	tag->global = wl_global_create(velox.display, &velox_tag_interface, 1, tag, &bind_tag);
 
 	if (!tag->global)
-		goto error2;
+		goto error1;
 
-	tag->config.group.name = strdup(tag->name);
+	tag->config.group.name = tag->name;
 	tag->config.group.type = CONFIG_NODE_TYPE_GROUP;
 	wl_list_init(&tag->config.group.group);
 	wl_list_insert(&tag_group.group, &tag->config.group.link);
@@ -167,8 +188,6 @@ tag_new(unsigned index, const char *name)
 
 	return tag;
 
-error2:
-	free(tag->name);
 error1:
 	free(tag);
 error0:
@@ -178,7 +197,6 @@ error0:
 void
 tag_destroy(struct tag *tag)
 {
-	free(tag->name);
 	free(tag);
 }
 
@@ -199,7 +217,8 @@ tag_add(struct tag *tag, struct screen *screen)
 	}
 
 	wl_resource_for_each (resource, &tag->resources)
-		tag_send_screen(tag, wl_resource_get_client(resource), resource, NULL);
+		tag_send_screen(tag, wl_resource_get_user_data(resource), resource, NULL);
+	subscription_notify_tag(tag);
 }
 
 void
@@ -226,19 +245,18 @@ tag_set(struct tag *tag, struct screen *screen)
 }
 
 void
-tag_send_screen(struct tag *tag, struct wl_client *client,
+tag_send_screen(struct tag *tag, struct client *client,
                 struct wl_resource *tag_resource, struct wl_resource *screen_resource)
 {
 	if (!tag_resource)
-		tag_resource = wl_resource_find_for_client(&tag->resources, client);
+		tag_resource = client_tag(client, tag);
 
-	if (!screen_resource) {
-		screen_resource = tag->screen
-		                      ? wl_resource_find_for_client(&tag->screen->resources, client)
-		                      : NULL;
-	}
+	if (!screen_resource)
+		screen_resource = tag->screen ? client_screen(client, tag->screen) : NULL;
 
+	TRACE_INSTANT("velox_tag.screen");
 	velox_tag_send_screen(tag_resource, screen_resource);
+	client_sent(client, CLIENT_VELOX_TAG, WIRE_HEADER + WIRE_WORD);
 }
 
 void
@@ -247,6 +265,10 @@ tag_update_num_windows(struct tag *tag, int change)
 	struct wl_resource *resource;
 
 	tag->num_windows += change;
-	wl_resource_for_each (resource, &tag->resources)
+	wl_resource_for_each (resource, &tag->resources) {
+		TRACE_INSTANT("velox_tag.state");
 		velox_tag_send_state(resource, tag->num_windows);
+		client_sent(wl_resource_get_user_data(resource), CLIENT_VELOX_TAG, WIRE_HEADER + WIRE_WORD);
+	}
+	subscription_notify_tag(tag);
 }
@@ -31,10 +31,12 @@
 
 #define TAG_MASK(n) (1 << (n))
 
+struct client;
 struct window;
 
 struct tag {
-	char *name;
+	/* Interned, see intern.h. */
+	const char *name;
 	uint32_t mask;
 	struct screen *screen;
 	struct wl_list link;
@@ -81,9 +83,11 @@ void tag_set(struct tag *tag, struct screen *screen);
  * Either tag_resource, screen_resource, or both may be NULL in which case the
  * correct resource is found using client.
  */
-void tag_send_screen(struct tag *tag, struct wl_client *client,
+void tag_send_screen(struct tag *tag, struct client *client,
                      struct wl_resource *tag_resource, struct wl_resource *screen_resource);
 
 void tag_update_num_windows(struct tag *tag, int change);
 
+struct wl_resource *tag_bind(struct tag *tag, struct wl_client *client, uint32_t version, uint32_t id);
+
 #endif
@@ -0,0 +1,131 @@
+/* velox: trace.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trace.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+#define TRACE_SIZE (1 << 16)
+
+struct event {
+	uint64_t time;
+	const char *name;
+	char phase;
+};
+
+/* Events are written to the slot claimed by atomically incrementing the
+ * position, so older events are overwritten once the buffer wraps. */
+static struct {
+	struct event events[TRACE_SIZE];
+	unsigned long position;
+} trace;
+
+void
+trace_event(enum trace_phase phase, const char *name)
+{
+	unsigned long position = __atomic_fetch_add(&trace.position, 1, __ATOMIC_RELAXED);
+	struct event *event = &trace.events[position % TRACE_SIZE];
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	event->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	event->name = name;
+	event->phase = phase;
+}
+
+static void
+write_string(FILE *file, const char *string)
+{
+	fputc('"', file);
+	for (; *string; ++string) {
+		if (*string == '"' || *string == '\\')
+			fputc('\\', file);
+		if ((unsigned char)*string >= 0x20)
+			fputc(*string, file);
+	}
+	fputc('"', file);
+}
+
+/* Write the events in the buffer in the Chrome trace event format, which can
+ * be loaded in chrome://tracing or Perfetto. */
+void
+trace_dump(void)
+{
+	char default_path[64];
+	const char *path;
+	unsigned long end = __atomic_load_n(&trace.position, __ATOMIC_ACQUIRE), position;
+	const struct event *event;
+	pid_t pid = getpid();
+	FILE *file;
+	bool first = true;
+
+	if (!(path = getenv("VELOX_TRACE_FILE"))) {
+		snprintf(default_path, sizeof(default_path), "/tmp/velox-trace-%ld.json", (long)pid);
+		path = default_path;
+	}
+
+	if (!(file = fopen(path, "w"))) {
+		fprintf(stderr, "Could not open trace file '%s'\n", path);
+		return;
+	}
+
+	fputs("{\"traceEvents\":[\n", file);
+	for (position = end > TRACE_SIZE ? end - TRACE_SIZE : 0; position < end; ++position) {
+		event = &trace.events[position % TRACE_SIZE];
+		if (!event->name)
+			continue;
+		if (!first)
+			fputs(",\n", file);
+		fputs("{\"name\":", file);
+		write_string(file, event->name);
+		fprintf(file, ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%ld,\"tid\":%ld%s}",
+		        event->phase, (unsigned long long)(event->time / 1000), (unsigned)(event->time % 1000),
+		        (long)pid, (long)pid, event->phase == TRACE_PHASE_INSTANT ? ",\"s\":\"t\"" : "");
+		first = false;
+	}
+	fputs("\n]}\n", file);
+
+	if (fclose(file) != 0)
+		fprintf(stderr, "Could not write trace file '%s'\n", path);
+	else
+		fprintf(stderr, "Wrote trace to '%s'\n", path);
+}
+
+static int
+handle_usr1(int num, void *data)
+{
+	trace_dump();
+	return 0;
+}
+
+bool
+trace_initialize(struct wl_event_loop *event_loop)
+{
+	return wl_event_loop_add_signal(event_loop, SIGUSR1, &handle_usr1, NULL) != NULL;
+}
@@ -0,0 +1,55 @@
+/* velox: trace.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_TRACE_H
+#define VELOX_TRACE_H
+
+#include <stdbool.h>
+
+struct wl_event_loop;
+
+#if ENABLE_TRACE
+enum trace_phase {
+	TRACE_PHASE_BEGIN = 'B',
+	TRACE_PHASE_END = 'E',
+	TRACE_PHASE_INSTANT = 'i',
+};
+
+/* The name must remain valid for the lifetime of the process. */
+void trace_event(enum trace_phase phase, const char *name);
+bool trace_initialize(struct wl_event_loop *event_loop);
+void trace_dump(void);
+
+#define TRACE_BEGIN(name) trace_event(TRACE_PHASE_BEGIN, name)
+#define TRACE_END(name) trace_event(TRACE_PHASE_END, name)
+#define TRACE_INSTANT(name) trace_event(TRACE_PHASE_INSTANT, name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+
+static inline bool trace_initialize(struct wl_event_loop *event_loop) { return true; }
+static inline void trace_dump(void) {}
+#endif
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "util.h"
 
+#include <time.h>
 #include <wayland-server.h>
 
 void
@@ -30,3 +31,12 @@ remove_resource(struct wl_resource *resource)
 {
 	wl_list_remove(wl_resource_get_link(resource));
 }
+
+uint32_t
+get_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -24,10 +24,15 @@
 #ifndef VELOX_UTIL_H
 #define VELOX_UTIL_H
 
+#include <stdint.h>
+
 #define ARRAY_LENGTH(array) (sizeof array / sizeof array[0])
 
 struct wl_resource;
 
 void remove_resource(struct wl_resource *resource);
 
+/* Monotonic time in milliseconds. */
+uint32_t get_time(void);
+
 #endif
@@ -23,15 +23,25 @@
  */
 
 #include "velox.h"
+#include "client.h"
 #include "config.h"
+#include "intern.h"
+#include "latency.h"
 #include "layout.h"
+#include "record.h"
 #include "screen.h"
+#include "stats.h"
+#include "subscription.h"
 #include "tag.h"
+#include "trace.h"
+#include "watchdog.h"
 #include "window.h"
 #include "protocol/velox-server-protocol.h"
 
+#include <errno.h>
 #include <libinput.h>
 #include <limits.h>
+#include <poll.h>
 #include <signal.h>
 #include <spawn.h>
 #include <stdlib.h>
@@ -45,12 +55,14 @@
 struct velox velox;
 unsigned border_width = 2;
 unsigned tap_to_click = 1;
+unsigned title_interval = 16;
 
 static void
 new_screen(struct swc_screen *swc)
 {
 	struct screen *screen;
 
+	record_screen_new(swc);
 	if (!(screen = screen_new(swc)))
 		return;
 
@@ -63,6 +75,7 @@ new_window(struct swc_window *swc)
 {
 	struct window *window;
 
+	record_window_new(swc);
 	if (!(window = window_new(swc)))
 		return;
 
@@ -102,40 +115,70 @@ found:
 		wl_client_post_no_memory(client);
 }
 
+static void
+subscribe(struct wl_client *client, struct wl_resource *resource,
+          uint32_t id, uint32_t classes)
+{
+	if (!subscription_new(client, id, classes))
+		wl_client_post_no_memory(client);
+}
+
+static void
+get_stats(struct wl_client *client, struct wl_resource *resource, uint32_t id)
+{
+	if (!stats_new(client, id))
+		wl_client_post_no_memory(client);
+}
+
 static const struct velox_interface velox_implementation = {
 	.get_screen = &get_screen,
+	.subscribe = &subscribe,
+	.get_stats = &get_stats,
 };
 
 static void
 apply_rules(struct window *window)
 {
 	struct rule *rule;
-	const char *identifier;
+	const char *title, *app_id, *value, *identifier;
+
+	if (wl_list_empty(&velox.rules))
+		return;
+
+	/* Rule identifiers are interned, so a string that was never interned can't
+	 * match any of them, and the rest can be compared by pointer. */
+	title = window->swc->title ? intern_lookup(window->swc->title) : NULL;
+	app_id = window->swc->app_id ? intern_lookup(window->swc->app_id) : NULL;
 
 	wl_list_for_each (rule, &velox.rules, link) {
 		switch (rule->type) {
 		case RULE_TYPE_WINDOW_TITLE:
-			identifier = window->swc->title;
+			value = window->swc->title;
+			identifier = title;
 			break;
 		case RULE_TYPE_APP_ID:
-			identifier = window->swc->app_id;
+			value = window->swc->app_id;
+			identifier = app_id;
 			break;
 		default:
+			value = NULL;
 			identifier = NULL;
 			break;
 		}
 
-		if (!identifier)
+		if (!value)
 			continue;
 
-		if (strcmp(identifier, rule->identifier) == 0) {
+		++stats[STAT_RULES_EVALUATED];
+		if (identifier == rule->identifier) {
 			struct config_node *node = rule->action;
 			const struct variant v = {
 				.type = VARIANT_WINDOW,
 				.window = window
 			};
 
-			node->action.run(node, &v);
+			++stats[STAT_RULES_MATCHED];
+			config_run(node, &v);
 		}
 	}
 }
@@ -145,27 +188,39 @@ manage(struct window *window)
 {
 	struct tag *tag;
 
-	wl_list_insert(&velox.hidden_windows, &window->link);
-
+	TRACE_BEGIN("manage");
 	apply_rules(window);
 	if (!window->tag) {
 		tag = wl_container_of(velox.active_screen->tags.next, tag, link);
 		window_set_tag(window, tag);
 	}
-	if (window->tag->screen)
+	/* Don't take the focus from a fullscreen window. */
+	if (window->tag->screen && !window->tag->screen->fullscreen)
 		screen_set_focus(window->tag->screen, window);
 	update();
+	TRACE_END("manage");
 }
 
 void
 unmanage(struct window *window)
 {
 	struct screen *screen = window->tag->screen;
+	bool fullscreen = window->fullscreen;
 
+	TRACE_BEGIN("unmanage");
+	/* The window is going away, so leave fullscreen without telling swc. */
+	if (fullscreen) {
+		window->fullscreen->fullscreen = NULL;
+		window->fullscreen = NULL;
+	}
 	window_set_tag(window, NULL);
-	wl_list_remove(&window->link);
-	if (screen)
+	window_remove(window);
+	/* A fullscreen window was hiding the rest of its screen. */
+	if (fullscreen)
+		update();
+	else if (screen)
 		screen_arrange(screen);
+	TRACE_END("unmanage");
 }
 
 void
@@ -173,27 +228,38 @@ arrange(void)
 {
 	struct screen *screen;
 
+	TRACE_BEGIN("arrange");
 	wl_list_for_each (screen, &velox.screens, link)
 		screen_arrange(screen);
+	TRACE_END("arrange");
 }
 
 void
 update(void)
 {
 	struct screen *screen;
-	struct window *window;
+	struct window_entry *entry;
+	bool visible;
 
 	/* Arrange the windows first so that they aren't shown before they are the
 	 * correct size. */
 	arrange();
 
 	wl_list_for_each (screen, &velox.screens, link) {
-		wl_list_for_each (window, &screen->windows, link)
-			window_show(window);
+		wl_array_for_each (entry, &screen->windows) {
+			/* Windows covered by a fullscreen window are hidden. */
+			visible = !screen->fullscreen || entry->window == screen->fullscreen;
+			if (visible && !entry->visible)
+				window_show(entry->window);
+			else if (!visible && entry->visible)
+				window_hide(entry->window);
+		}
 	}
 
-	wl_list_for_each (window, &velox.hidden_windows, link)
-		window_hide(window);
+	wl_array_for_each (entry, &velox.hidden_windows) {
+		if (entry->visible)
+			window_hide(entry->window);
+	}
 }
 
 struct tag *
@@ -240,24 +306,23 @@ static void
 zoom(struct config_node *node, const struct variant *v)
 {
 	struct screen *screen = velox.active_screen;
-	struct wl_list *link;
+	struct window *window;
 
 	if (!screen->focus)
 		return;
 
 	/* Move the focus to the beginning of the window list, or if it is already
 	 * there, the window after the focus. */
-	link = &screen->focus->link;
+	window = screen->focus;
 
-	if (screen->windows.next == link) {
-		if (link->next == &screen->windows)
+	if (window->index == 0) {
+		if (window_count(&screen->windows) == 1)
 			return;
 
-		link = link->next;
+		window = window_entries(&screen->windows)[1].window;
 	}
 
-	wl_list_remove(link);
-	wl_list_insert(&screen->windows, link);
+	window_insert(window, &screen->windows, 0);
 	arrange();
 }
 
@@ -272,6 +337,7 @@ layout_next(struct config_node *node, const struct variant *v)
 		link = link->next;
 	*layout = wl_container_of(link, *layout, link);
 	screen_arrange(screen);
+	subscription_notify_layout(screen);
 }
 
 static void
@@ -287,7 +353,25 @@ previous_tags(struct config_node *node, const struct variant *v)
 static void
 quit(struct config_node *node, const struct variant *v)
 {
-	wl_display_terminate(velox.display);
+	velox.running = false;
+}
+
+static void
+dump_clients(struct config_node *node, const struct variant *v)
+{
+	client_print();
+}
+
+static void
+print_latency(struct config_node *node, const struct variant *v)
+{
+	latency_print();
+}
+
+static void
+dump_trace(struct config_node *node, const struct variant *v)
+{
+	trace_dump();
 }
 
 static CONFIG_ACTION(focus_next, &focus_next);
@@ -296,6 +380,9 @@ static CONFIG_ACTION(zoom, &zoom);
 static CONFIG_ACTION(layout_next, &layout_next);
 static CONFIG_ACTION(previous_tags, &previous_tags);
 static CONFIG_ACTION(quit, &quit);
+static CONFIG_ACTION(dump_trace, &dump_trace);
+static CONFIG_ACTION(print_latency, &print_latency);
+static CONFIG_ACTION(dump_clients, &dump_clients);
 
 static void
 add_config_nodes(void)
@@ -306,6 +393,9 @@ add_config_nodes(void)
 	wl_list_insert(config_root, &layout_next_action.link);
 	wl_list_insert(config_root, &previous_tags_action.link);
 	wl_list_insert(config_root, &quit_action.link);
+	wl_list_insert(config_root, &dump_trace_action.link);
+	wl_list_insert(config_root, &print_latency_action.link);
+	wl_list_insert(config_root, &dump_clients_action.link);
 
 	layout_add_config_nodes();
 	tag_add_config_nodes();
@@ -328,6 +418,7 @@ start_clients(void)
 	if (ret < 0 || ret >= sizeof(path))
 		return;
 	posix_spawn(&pid, path, NULL, NULL, (char *[]){path, NULL}, environ);
+	++stats[STAT_SPAWNS];
 }
 
 static int
@@ -339,21 +430,63 @@ handle_chld(int num, void *data)
 	return 0;
 }
 
+static int
+handle_term(int num, void *data)
+{
+	velox.running = false;
+	return 0;
+}
+
+/* Like wl_display_run, but waits for events separately from dispatching them,
+ * so that the watchdog only sees the time spent handling them. */
+static void
+run(void)
+{
+	struct pollfd fd = { .fd = wl_event_loop_get_fd(velox.event_loop), .events = POLLIN };
+
+	velox.running = true;
+	while (velox.running) {
+		watchdog_begin("dispatch");
+		wl_event_loop_dispatch(velox.event_loop, 0);
+		/* Idle sources added by the handlers above. */
+		wl_event_loop_dispatch_idle(velox.event_loop);
+		watchdog_end();
+
+		wl_display_flush_clients(velox.display);
+		client_update_queued();
+		if (velox.running && poll(&fd, 1, -1) == -1 && errno != EINTR)
+			break;
+	}
+}
+
+static void
+destroy_velox_resource(struct wl_resource *resource)
+{
+	client_remove_resource(wl_resource_get_user_data(resource), CLIENT_VELOX);
+}
+
 static void
 bind_velox(struct wl_client *client, void *data,
            uint32_t version, uint32_t id)
 {
 	struct wl_resource *resource;
+	struct client *record;
+
+	if (version >= 3)
+		version = 3;
 
-	if (version >= 1)
-		version = 1;
+	if (!(record = client_get(client))) {
+		wl_client_post_no_memory(client);
+		return;
+	}
 
 	if (!(resource = wl_resource_create(client, &velox_interface, version, id))) {
 		wl_client_post_no_memory(client);
 		return;
 	}
 
-	wl_resource_set_implementation(resource, &velox_implementation, NULL, NULL);
+	wl_resource_set_implementation(resource, &velox_implementation, record, &destroy_velox_resource);
+	client_add_resource(record, CLIENT_VELOX);
 }
 
 int
@@ -372,14 +505,20 @@ main(int argc, char *argv[])
 		goto error1;
 	setenv("WAYLAND_DISPLAY", socket, 1);
 
-	velox.global = wl_global_create(velox.display, &velox_interface, 1, NULL, &bind_velox);
+	velox.global = wl_global_create(velox.display, &velox_interface, 3, NULL, &bind_velox);
 	if (!velox.global)
 		goto error1;
 
 	velox.event_loop = wl_display_get_event_loop(velox.display);
 	wl_event_loop_add_signal(velox.event_loop, SIGCHLD, &handle_chld, NULL);
+	wl_event_loop_add_signal(velox.event_loop, SIGTERM, &handle_term, NULL);
+	wl_event_loop_add_signal(velox.event_loop, SIGINT, &handle_term, NULL);
+	if (!trace_initialize(velox.event_loop))
+		goto error1;
+	if (!record_initialize())
+		goto error1;
 	wl_list_init(&velox.screens);
-	wl_list_init(&velox.hidden_windows);
+	wl_array_init(&velox.hidden_windows);
 	wl_list_init(&velox.unused_tags);
 	wl_list_init(&velox.rules);
 	add_config_nodes();
@@ -397,13 +536,23 @@ main(int argc, char *argv[])
 	if (!swc_initialize(velox.display, NULL, &manager))
 		goto error2;
 
+	/* The status bar's requests won't be handled until we start dispatching,
+	 * but it can get through the rest of its startup while we parse the
+	 * configuration. */
+	start_clients();
+
 	if (!config_parse())
 		goto error3;
+	if (!watchdog_initialize())
+		goto error3;
 
-	start_clients();
-
-	wl_display_run(velox.display);
+	run();
+	watchdog_finalize();
+	latency_print();
+	latency_finalize();
+	record_finalize();
 	swc_finalize();
+	intern_finalize();
 
 	return EXIT_SUCCESS;
 
@@ -412,6 +561,7 @@ error3:
 error2:
 	while (index > 0)
 		tag_destroy(velox.tags[--index]);
+	record_finalize();
 	wl_global_destroy(velox.global);
 error1:
 	wl_display_destroy(velox.display);
@@ -25,6 +25,7 @@
 #ifndef VELOX_VELOX_H
 #define VELOX_VELOX_H
 
+#include <stdbool.h>
 #include <wayland-util.h>
 
 #define NUM_TAGS 9
@@ -36,7 +37,8 @@ struct rule {
 		RULE_TYPE_WINDOW_TITLE,
 		RULE_TYPE_APP_ID,
 	} type;
-	char *identifier;
+	/* Interned, see intern.h. */
+	const char *identifier;
 	struct config_node *action;
 
 	struct wl_list link;
@@ -47,17 +49,19 @@ struct velox {
 	struct wl_event_loop *event_loop;
 	struct screen *active_screen;
 	struct wl_list screens;
-	struct wl_list hidden_windows;
+	struct wl_array hidden_windows;
 	struct wl_list unused_tags;
 	struct wl_list rules;
 	struct tag *tags[NUM_TAGS];
 
 	struct wl_global *global;
+	bool running;
 };
 
 extern struct velox velox;
 extern unsigned border_width;
 extern unsigned tap_to_click;
+extern unsigned title_interval;
 
 void manage(struct window *window);
 void unmanage(struct window *window);
@@ -0,0 +1,213 @@
+/* velox: watchdog.c
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "watchdog.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_DEPTH 8
+
+struct activity {
+	const char *name;
+	uint64_t start;
+};
+
+/* The main thread records what it is doing, and a separate thread checks it
+ * periodically, so that a loop which never returns is still reported. The
+ * mutex is only held briefly on either side, never while work is done. */
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+	bool running;
+
+	struct activity stack[MAX_DEPTH];
+	unsigned depth;
+	/* Incremented each time the main thread starts on something new, so that
+	 * each stall is only reported once. */
+	unsigned long generation, reported;
+	unsigned long windows;
+} watchdog = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+unsigned watchdog_threshold;
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+report(const struct activity *stack, unsigned depth, unsigned long windows, uint64_t time)
+{
+	unsigned index;
+
+	fprintf(stderr, "watchdog: stalled for %llums, %lu windows touched, in:\n",
+	        (unsigned long long)(time - stack[0].start) / 1000000, windows);
+	for (index = 0; index < depth && index < MAX_DEPTH; ++index) {
+		fprintf(stderr, "watchdog:   %s (%llums)\n", stack[index].name,
+		        (unsigned long long)(time - stack[index].start) / 1000000);
+	}
+	trace_dump();
+}
+
+static void *
+run(void *data)
+{
+	struct activity stack[MAX_DEPTH];
+	unsigned depth;
+	unsigned long windows;
+	uint64_t threshold = (uint64_t)watchdog_threshold * 1000000, interval = threshold / 4, time;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&watchdog.mutex);
+	while (watchdog.running) {
+		time = now() + interval;
+		deadline.tv_sec = time / 1000000000;
+		deadline.tv_nsec = time % 1000000000;
+		pthread_cond_timedwait(&watchdog.cond, &watchdog.mutex, &deadline);
+
+		time = now();
+		if (watchdog.depth == 0 || watchdog.reported == watchdog.generation
+		    || time - watchdog.stack[0].start < threshold)
+			continue;
+
+		watchdog.reported = watchdog.generation;
+		depth = watchdog.depth;
+		memcpy(stack, watchdog.stack, sizeof(stack));
+		windows = __atomic_load_n(&watchdog.windows, __ATOMIC_RELAXED);
+
+		/* Don't hold up the main thread while we write out the report. */
+		pthread_mutex_unlock(&watchdog.mutex);
+		report(stack, depth, windows, time);
+		pthread_mutex_lock(&watchdog.mutex);
+	}
+	pthread_mutex_unlock(&watchdog.mutex);
+
+	return NULL;
+}
+
+bool
+watchdog_initialize(void)
+{
+	pthread_condattr_t attr;
+
+	if (watchdog_threshold == 0)
+		return true;
+
+	if (pthread_condattr_init(&attr) != 0)
+		goto error0;
+	if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0)
+		goto error1;
+	if (pthread_cond_init(&watchdog.cond, &attr) != 0)
+		goto error1;
+
+	watchdog.running = true;
+	if (pthread_create(&watchdog.thread, NULL, &run, NULL) != 0)
+		goto error2;
+	pthread_condattr_destroy(&attr);
+
+	return true;
+
+error2:
+	watchdog.running = false;
+	pthread_cond_destroy(&watchdog.cond);
+error1:
+	pthread_condattr_destroy(&attr);
+error0:
+	fprintf(stderr, "Could not start watchdog thread\n");
+	return false;
+}
+
+void
+watchdog_finalize(void)
+{
+	if (!watchdog.running)
+		return;
+
+	pthread_mutex_lock(&watchdog.mutex);
+	watchdog.running = false;
+	pthread_cond_signal(&watchdog.cond);
+	pthread_mutex_unlock(&watchdog.mutex);
+	pthread_join(watchdog.thread, NULL);
+	pthread_cond_destroy(&watchdog.cond);
+}
+
+void
+watchdog_begin(const char *name)
+{
+	uint64_t time;
+
+	if (!watchdog.running)
+		return;
+
+	time = now();
+	pthread_mutex_lock(&watchdog.mutex);
+	if (watchdog.depth == 0) {
+		++watchdog.generation;
+		__atomic_store_n(&watchdog.windows, 0, __ATOMIC_RELAXED);
+	}
+	if (watchdog.depth < MAX_DEPTH)
+		watchdog.stack[watchdog.depth] = (struct activity){ name, time };
+	++watchdog.depth;
+	pthread_mutex_unlock(&watchdog.mutex);
+}
+
+void
+watchdog_end(void)
+{
+	struct activity activity = { 0 };
+	unsigned long windows;
+	uint64_t time;
+
+	if (!watchdog.running)
+		return;
+
+	time = now();
+	pthread_mutex_lock(&watchdog.mutex);
+	if (--watchdog.depth < MAX_DEPTH)
+		activity = watchdog.stack[watchdog.depth];
+	windows = __atomic_load_n(&watchdog.windows, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&watchdog.mutex);
+
+	if (activity.name && time - activity.start >= (uint64_t)watchdog_threshold * 1000000) {
+		fprintf(stderr, "watchdog: %s took %llums, %lu windows touched\n", activity.name,
+		        (unsigned long long)(time - activity.start) / 1000000, windows);
+	}
+}
+
+void
+watchdog_touch(void)
+{
+	__atomic_fetch_add(&watchdog.windows, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,43 @@
+/* velox: watchdog.h
+ *
+ * Copyright (c) 2014 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VELOX_WATCHDOG_H
+#define VELOX_WATCHDOG_H
+
+#include <stdbool.h>
+
+/* Dispatches and actions taking longer than this many milliseconds are
+ * reported. The watchdog is disabled if this is 0 at startup. */
+extern unsigned watchdog_threshold;
+
+bool watchdog_initialize(void);
+void watchdog_finalize(void);
+
+/* Called around each event loop dispatch and each action. These may nest, and
+ * the name must remain valid for the lifetime of the process. */
+void watchdog_begin(const char *name);
+void watchdog_end(void);
+/* Called whenever the geometry or visibility of a window is changed. */
+void watchdog_touch(void);
+
+#endif
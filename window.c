@@ -23,15 +23,33 @@
 
 #include "window.h"
 #include "config.h"
+#include "latency.h"
+#include "pool.h"
+#include "record.h"
 #include "screen.h"
+#include "stats.h"
+#include "subscription.h"
 #include "tag.h"
+#include "trace.h"
 #include "velox.h"
+#include "watchdog.h"
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <swc.h>
+#include <sys/param.h>
 
 static uint32_t border_color_active = 0xff338833;
 static uint32_t border_color_inactive = 0xff888888;
+static unsigned cascade_offset = 32;
+
+enum direction {
+	LEFT,
+	RIGHT,
+	UP,
+	DOWN,
+};
 
 static bool
 border_width_set(struct config_node *node, const char *value)
@@ -39,6 +57,12 @@ border_width_set(struct config_node *node, const char *value)
 	return config_set_unsigned(&border_width, value, 0);
 }
 
+static bool
+title_interval_set(struct config_node *node, const char *value)
+{
+	return config_set_unsigned(&title_interval, value, 10);
+}
+
 static bool
 border_color_active_set(struct config_node *node, const char *value)
 {
@@ -51,6 +75,157 @@ border_color_inactive_set(struct config_node *node, const char *value)
 	return config_set_unsigned(&border_color_inactive, value, 16);
 }
 
+/* Stacked windows are kept in the spatial index of their screen while velox
+ * knows their geometry. Without a geometry, it is up to swc and the client; that
+ * includes transient windows, which the client sizes, and windows that were
+ * moved or resized interactively, since swc reports nothing back. */
+static void
+set_floating_geometry(struct window *window, const struct swc_rectangle *geometry)
+{
+	struct window_entry *entry = window_entry(window);
+	struct screen *screen = window->tag ? window->tag->screen : NULL;
+
+	/* Windows moving between screens are indexed when they arrive. */
+	if (screen && window->array != &screen->windows)
+		screen = NULL;
+
+	if (screen && entry->layer == STACK)
+		spatial_remove(&screen->floating, window, &entry->geometry);
+
+	if (!geometry) {
+		memset(&entry->geometry, 0, sizeof(entry->geometry));
+		return;
+	}
+
+	swc_window_set_geometry(window->swc, geometry);
+	++stats[STAT_GEOMETRY];
+	watchdog_touch();
+	entry->geometry = *geometry;
+	if (screen && entry->layer == STACK)
+		spatial_insert(&screen->floating, window, geometry);
+}
+
+/* swc is about to move or resize the window itself. */
+static void
+float_window(struct window *window)
+{
+	window_set_layer(window, STACK);
+	set_floating_geometry(window, NULL);
+}
+
+/* Place a floating window, cascading it so that it doesn't hide another window
+ * with the same top-left corner. */
+static void
+place(struct window *window, struct swc_rectangle geometry)
+{
+	struct screen *screen = window->tag ? window->tag->screen : NULL;
+	struct window *other;
+	const struct swc_rectangle *g;
+	unsigned attempts;
+
+	for (attempts = 0; screen && attempts < 16; ++attempts) {
+		if (!(other = spatial_at(&screen->floating, geometry.x, geometry.y)))
+			break;
+		g = &window_entry(other)->geometry;
+		if (g->x != geometry.x || g->y != geometry.y)
+			break;
+		geometry.x += cascade_offset;
+		geometry.y += cascade_offset;
+	}
+
+	set_floating_geometry(window, &geometry);
+}
+
+struct snap {
+	struct window *window;
+	bool horizontal, forward;
+	int64_t start, end, edge;
+};
+
+static void
+snap_to(struct snap *snap, int64_t edge)
+{
+	if (snap->forward ? edge > snap->end && edge < snap->edge
+	                  : edge < snap->start && edge > snap->edge)
+		snap->edge = edge;
+}
+
+static void
+snap_item(const struct spatial_item *item, void *data)
+{
+	struct snap *snap = data;
+	const struct swc_rectangle *g = &item->geometry;
+
+	if (item->window == snap->window)
+		return;
+
+	if (snap->horizontal) {
+		snap_to(snap, g->x);
+		snap_to(snap, (int64_t)g->x + g->width);
+	} else {
+		snap_to(snap, g->y);
+		snap_to(snap, (int64_t)g->y + g->height);
+	}
+}
+
+/* Move a floating window to the next edge of another floating window or of the
+ * screen in the given direction. */
+static void
+move_to_edge(struct window *window, enum direction direction)
+{
+	struct screen *screen = window->tag ? window->tag->screen : NULL;
+	const struct swc_rectangle *area;
+	struct swc_rectangle geometry, strip;
+	struct snap snap;
+	int64_t area_start, area_end;
+
+	if (!screen || window->layer != STACK || window->fullscreen)
+		return;
+
+	geometry = window_entry(window)->geometry;
+	if (geometry.width == 0)
+		return;
+
+	area = &screen->swc->usable_geometry;
+	snap.window = window;
+	snap.horizontal = direction == LEFT || direction == RIGHT;
+	snap.forward = direction == RIGHT || direction == DOWN;
+	if (snap.horizontal) {
+		snap.start = geometry.x;
+		snap.end = (int64_t)geometry.x + geometry.width;
+		area_start = area->x;
+		area_end = (int64_t)area->x + area->width;
+	} else {
+		snap.start = geometry.y;
+		snap.end = (int64_t)geometry.y + geometry.height;
+		area_start = area->y;
+		area_end = (int64_t)area->y + area->height;
+	}
+	snap.edge = snap.forward ? INT64_MAX : INT64_MIN;
+	snap_to(&snap, snap.forward ? area_end : area_start);
+
+	/* Only windows between this one and the screen edge can be in the way. */
+	strip = geometry;
+	if (snap.horizontal) {
+		strip.x = snap.forward ? snap.end : area_start;
+		strip.width = snap.forward ? MAX(area_end - snap.end, 0) : MAX(snap.start - area_start, 0);
+	} else {
+		strip.y = snap.forward ? snap.end : area_start;
+		strip.height = snap.forward ? MAX(area_end - snap.end, 0) : MAX(snap.start - area_start, 0);
+	}
+	spatial_query(&screen->floating, &strip, &snap_item, &snap);
+
+	if (snap.edge == INT64_MAX || snap.edge == INT64_MIN)
+		return;
+
+	if (snap.horizontal)
+		geometry.x = snap.forward ? snap.edge - geometry.width : snap.edge;
+	else
+		geometry.y = snap.forward ? snap.edge - geometry.height : snap.edge;
+	set_floating_geometry(window, &geometry);
+	latency_mark();
+}
+
 static void
 begin_move(struct config_node *node, const struct variant *v)
 {
@@ -59,7 +234,7 @@ begin_move(struct config_node *node, const struct variant *v)
 	if (!w)
 		return;
 
-	window_set_layer(w, STACK);
+	float_window(w);
 	swc_window_begin_move(w->swc);
 }
 
@@ -82,7 +257,7 @@ begin_resize(struct config_node *node, const struct variant *v)
 	if (!w)
 		return;
 
-	window_set_layer(w, STACK);
+	float_window(w);
 	swc_window_begin_resize(w->swc, SWC_WINDOW_EDGE_AUTO);
 }
 
@@ -99,13 +274,71 @@ end_resize(struct config_node *node, const struct variant *v)
 
 static void
 switch_layer(struct config_node *node, const struct variant *v)
+{
+	struct window *w = window_or_focus(v);
+	struct swc_rectangle geometry;
+
+	if (!w)
+		return;
+
+	if (w->layer != TILE) {
+		window_set_layer(w, TILE);
+		return;
+	}
+
+	/* Float the window where it was tiled. */
+	geometry = window_entry(w)->geometry;
+	window_set_layer(w, STACK);
+	if (geometry.width > 0)
+		place(w, geometry);
+}
+
+static void
+move_left(struct config_node *node, const struct variant *v)
+{
+	struct window *w = window_or_focus(v);
+
+	if (w)
+		move_to_edge(w, LEFT);
+}
+
+static void
+move_right(struct config_node *node, const struct variant *v)
+{
+	struct window *w = window_or_focus(v);
+
+	if (w)
+		move_to_edge(w, RIGHT);
+}
+
+static void
+move_up(struct config_node *node, const struct variant *v)
+{
+	struct window *w = window_or_focus(v);
+
+	if (w)
+		move_to_edge(w, UP);
+}
+
+static void
+move_down(struct config_node *node, const struct variant *v)
+{
+	struct window *w = window_or_focus(v);
+
+	if (w)
+		move_to_edge(w, DOWN);
+}
+
+static void
+toggle_fullscreen(struct config_node *node, const struct variant *v)
 {
 	struct window *w = window_or_focus(v);
 
 	if (!w)
 		return;
 
-	window_set_layer(w, (w->layer + 1) % NUM_LAYERS);
+	window_set_fullscreen(w, !w->fullscreen);
+	update();
 }
 
 static void
@@ -123,11 +356,17 @@ static CONFIG_GROUP(window);
 static CONFIG_PROPERTY(border_width, &border_width_set);
 static CONFIG_PROPERTY(border_color_active, &border_color_active_set);
 static CONFIG_PROPERTY(border_color_inactive, &border_color_inactive_set);
+static CONFIG_PROPERTY(title_interval, &title_interval_set);
 static CONFIG_ACTION(begin_move, &begin_move);
 static CONFIG_ACTION(end_move, &end_move);
 static CONFIG_ACTION(begin_resize, &begin_resize);
 static CONFIG_ACTION(end_resize, &end_resize);
 static CONFIG_ACTION(switch_layer, &switch_layer);
+static CONFIG_ACTION(fullscreen, &toggle_fullscreen);
+static CONFIG_ACTION(move_left, &move_left);
+static CONFIG_ACTION(move_right, &move_right);
+static CONFIG_ACTION(move_up, &move_up);
+static CONFIG_ACTION(move_down, &move_down);
 static CONFIG_ACTION(close, &close_window);
 
 void
@@ -136,22 +375,138 @@ window_add_config_nodes(void)
 	wl_list_insert(&window_group.group, &border_width_property.link);
 	wl_list_insert(&window_group.group, &border_color_active_property.link);
 	wl_list_insert(&window_group.group, &border_color_inactive_property.link);
+	wl_list_insert(&window_group.group, &title_interval_property.link);
 	wl_list_insert(&window_group.group, &begin_move_action.link);
 	wl_list_insert(&window_group.group, &end_move_action.link);
 	wl_list_insert(&window_group.group, &begin_resize_action.link);
 	wl_list_insert(&window_group.group, &end_resize_action.link);
 	wl_list_insert(&window_group.group, &switch_layer_action.link);
+	wl_list_insert(&window_group.group, &fullscreen_action.link);
+	wl_list_insert(&window_group.group, &move_left_action.link);
+	wl_list_insert(&window_group.group, &move_right_action.link);
+	wl_list_insert(&window_group.group, &move_up_action.link);
+	wl_list_insert(&window_group.group, &move_down_action.link);
 	wl_list_insert(&window_group.group, &close_action.link);
 	wl_list_insert(config_root, &window_group.link);
 }
 
+/* Windows come and go all the time, so they are pooled to keep mapping and
+ * unmapping them off the heap. */
+static struct pool window_pool = POOL_INITIALIZER(struct window, 32);
+
+/* Make room for size more bytes in the array without changing its contents.
+ * Arrays never shrink, so this only allocates while the number of windows
+ * grows. */
+static bool
+reserve(struct wl_array *array, size_t size)
+{
+	if (array->alloc - array->size >= size)
+		return true;
+	if (!wl_array_add(array, size))
+		return false;
+	array->size -= size;
+	return true;
+}
+
+static void
+renumber(struct wl_array *array, unsigned index)
+{
+	struct window_entry *entries = window_entries(array);
+	unsigned count = window_count(array);
+
+	for (; index < count; ++index)
+		entries[index].window->index = index;
+}
+
+static void
+remove_entry(struct wl_array *array, unsigned index)
+{
+	struct window_entry *entries = window_entries(array);
+
+	memmove(&entries[index], &entries[index + 1], (window_count(array) - index - 1) * sizeof(*entries));
+	array->size -= sizeof(*entries);
+	renumber(array, index);
+}
+
+struct window_entry *
+window_entry(struct window *window)
+{
+	return &window_entries(window->array)[window->index];
+}
+
+bool
+window_insert(struct window *window, struct wl_array *array, unsigned index)
+{
+	struct window_entry entry, *entries;
+
+	if (window->array != array && !reserve(array, sizeof(entry)))
+		return false;
+
+	if (window->array) {
+		entry = *window_entry(window);
+		remove_entry(window->array, window->index);
+	} else {
+		entry = (struct window_entry){
+			.window = window,
+			.layer = window->layer,
+		};
+	}
+
+	entries = window_entries(array);
+	memmove(&entries[index + 1], &entries[index], (window_count(array) - index) * sizeof(entry));
+	entries[index] = entry;
+	array->size += sizeof(entry);
+	window->array = array;
+	renumber(array, index);
+
+	return true;
+}
+
+bool
+window_transfer(struct wl_array *dst, struct wl_array *src, uint32_t mask, bool match)
+{
+	struct window_entry *entries = window_entries(src), *entry;
+	unsigned index, count = window_count(src), kept = 0;
+
+	if (!reserve(dst, src->size))
+		return false;
+
+	for (index = 0; index < count; ++index) {
+		if (((entries[index].mask & mask) != 0) == match) {
+			entry = (void *)((char *)dst->data + dst->size);
+			*entry = entries[index];
+			entry->window->array = dst;
+			entry->window->index = window_count(dst);
+			dst->size += sizeof(*entry);
+		} else {
+			if (kept != index) {
+				entries[kept] = entries[index];
+				entries[kept].window->index = kept;
+			}
+			++kept;
+		}
+	}
+	src->size = kept * sizeof(*entries);
+
+	return true;
+}
+
+void
+window_remove(struct window *window)
+{
+	remove_entry(window->array, window->index);
+	window->array = NULL;
+}
+
 static void
 destroy(void *data)
 {
 	struct window *window = data;
 
+	record_window(RECORD_WINDOW_DESTROY, window->swc);
 	unmanage(window);
-	free(window);
+	pool_put(&window_pool, window);
+	--stats[STAT_WINDOWS];
 }
 
 static void
@@ -159,10 +514,12 @@ title_changed(void *data)
 {
 	struct window *window = data;
 
+	record_window_title(window->swc);
+
 	/* If this window focused on a screen, make sure bound clients are aware of
 	 * this title change. */
 	if (window->tag->screen && window->tag->screen->focus == window)
-		screen_focus_notify(window->tag->screen);
+		screen_title_changed(window->tag->screen);
 }
 
 static void
@@ -170,6 +527,7 @@ parent_changed(void *data)
 {
 	struct window *window = data;
 
+	record_window_parent(window->swc);
 	if (window->swc->parent)
 		window_set_layer(window, STACK);
 
@@ -181,6 +539,9 @@ entered(void *data)
 {
 	struct window *window = data;
 
+	record_window(RECORD_WINDOW_ENTER, window->swc);
+	if (window->tag->screen->fullscreen && window->tag->screen->fullscreen != window)
+		return;
 	window_focus(window);
 	window->tag->screen->focus = window;
 }
@@ -190,7 +551,7 @@ move(void *data)
 {
 	struct window *window = data;
 
-	window_set_layer(window, STACK);
+	float_window(window);
 }
 
 static void
@@ -198,7 +559,7 @@ resize(void *data)
 {
 	struct window *window = data;
 
-	window_set_layer(window, STACK);
+	float_window(window);
 }
 
 static const struct swc_window_handler window_handler = {
@@ -213,17 +574,28 @@ static const struct swc_window_handler window_handler = {
 struct window *
 window_new(struct swc_window *swc)
 {
+	static uint32_t next_id;
 	struct window *window;
 
-	if (!(window = malloc(sizeof *window)))
+	if (!(window = pool_get(&window_pool)))
 		return NULL;
 
 	window->swc = swc;
+	window->id = next_id++;
 	window->tag = NULL;
 	window->layer = STACK;
+	window->fullscreen = NULL;
+	window->array = NULL;
+
+	/* New windows are hidden until they are managed. */
+	if (!window_insert(window, &velox.hidden_windows, window_count(&velox.hidden_windows))) {
+		pool_put(&window_pool, window);
+		return NULL;
+	}
 
 	window_set_layer(window, TILE);
 	swc_window_set_handler(swc, &window_handler, window);
+	++stats[STAT_WINDOWS];
 
 	return window;
 }
@@ -236,6 +608,9 @@ window_focus(struct window *window)
 	 * focus is removed (before it is actually destroyed). */
 	static struct window *focused_window;
 
+	TRACE_BEGIN("window_focus");
+	if (window != focused_window)
+		++stats[STAT_FOCUS];
 	if (focused_window)
 		swc_window_set_border(focused_window->swc, border_color_inactive, border_width);
 
@@ -247,18 +622,27 @@ window_focus(struct window *window)
 	}
 
 	focused_window = window;
+	TRACE_END("window_focus");
 }
 
 void
 window_show(struct window *window)
 {
 	swc_window_show(window->swc);
+	window_entry(window)->visible = true;
+	++stats[STAT_SHOW];
+	watchdog_touch();
+	latency_mark();
 }
 
 void
 window_hide(struct window *window)
 {
 	swc_window_hide(window->swc);
+	window_entry(window)->visible = false;
+	++stats[STAT_HIDE];
+	watchdog_touch();
+	latency_mark();
 }
 
 void
@@ -270,6 +654,8 @@ window_set_tag(struct window *window, struct tag *tag)
 		return;
 
 	window->tag = tag;
+	window_entry(window)->mask = tag ? tag->mask : 0;
+	subscription_notify_window(window);
 
 	if (old_tag)
 		tag_update_num_windows(old_tag, -1);
@@ -293,12 +679,24 @@ window_set_tag(struct window *window, struct tag *tag)
 void
 window_set_layer(struct window *window, int layer)
 {
-	int old_layer = window->layer;
+	struct window_entry *entry = window_entry(window);
 
-	if (layer == old_layer)
+	if (layer == window->layer)
 		return;
 
+	/* Setting the layer below takes the window out of fullscreen. */
+	if (window->fullscreen) {
+		window->fullscreen->fullscreen = NULL;
+		window->fullscreen = NULL;
+	}
+
+	/* swc changes the geometry of the window itself, so the next arrangement
+	 * must set it regardless. */
+	set_floating_geometry(window, NULL);
 	window->layer = layer;
+	entry->layer = layer;
+	if (window->tag)
+		subscription_notify_window(window);
 
 	switch (layer) {
 	case TILE:
@@ -310,10 +708,49 @@ window_set_layer(struct window *window, int layer)
 		break;
 	}
 
-	if (window->tag && window->tag->screen) {
-		--window->tag->screen->num_windows[old_layer];
-		++window->tag->screen->num_windows[layer];
+	if (window->tag && window->tag->screen)
 		update();
+}
+
+void
+window_set_fullscreen(struct window *window, bool fullscreen)
+{
+	struct screen *screen = window->tag ? window->tag->screen : NULL;
+	struct window_entry *entry = window_entry(window);
+
+	if (fullscreen == (window->fullscreen != NULL))
+		return;
+
+	if (fullscreen) {
+		if (!screen)
+			return;
+		if (screen->fullscreen)
+			window_set_fullscreen(screen->fullscreen, false);
+
+		screen->fullscreen = window;
+		window->fullscreen = screen;
+		swc_window_set_fullscreen(window->swc, screen->swc);
+		++stats[STAT_GEOMETRY];
+		screen_set_focus(screen, window);
+		return;
+	}
+
+	window->fullscreen->fullscreen = NULL;
+	window->fullscreen = NULL;
+
+	if (window->layer == TILE)
+		swc_window_set_tiled(window->swc);
+	else
+		swc_window_set_stacked(window->swc);
+
+	/* The screen wasn't arranged while the window was fullscreen, so put it
+	 * back where it was. For tiled windows, the next arrangement only moves it
+	 * if the rest of the screen changed in the meantime. */
+	if (entry->geometry.width > 0) {
+		swc_window_set_geometry(window->swc, &entry->geometry);
+		++stats[STAT_GEOMETRY];
+	} else if (window->layer == STACK) {
+		swc_window_set_size(window->swc, 0, 0);
 	}
 }
 
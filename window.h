@@ -24,19 +24,57 @@
 #ifndef VELOX_WINDOW_H
 #define VELOX_WINDOW_H
 
+#include <stdbool.h>
+#include <swc.h>
 #include <wayland-server.h>
 
-struct swc_window;
 struct variant;
 
 struct window {
 	struct swc_window *swc;
-	struct wl_list link;
+	uint32_t id;
 
 	int layer;
 	struct tag *tag;
+	/* The screen this window covers, if it is fullscreen. */
+	struct screen *fullscreen;
+
+	/* The array of window entries this window is in, and its position. */
+	struct wl_array *array;
+	unsigned index;
+};
+
+/**
+ * Every window has an entry in exactly one array: that of the screen it is
+ * shown on, or velox.hidden_windows. The arrays keep the window order, and
+ * the entries hold copies of the fields that arranging and tag filtering
+ * need, so that those are linear scans that don't touch the windows
+ * themselves.
+ */
+struct window_entry {
+	struct window *window;
+	/* The mask of the window's tag, or 0 if it has none. */
+	uint32_t mask;
+	int layer;
+	/* The visibility and geometry last handed to swc. */
+	bool visible;
+	struct swc_rectangle geometry;
 };
 
+#define window_entries(array) ((struct window_entry *)(array)->data)
+#define window_count(array) ((array)->size / sizeof(struct window_entry))
+
+struct window_entry *window_entry(struct window *window);
+
+/* Move the window to the given position of an array, after removing it from
+ * the array it is in. */
+bool window_insert(struct window *window, struct wl_array *array, unsigned index);
+void window_remove(struct window *window);
+
+/* Move the entries of src whose mask does (or does not) intersect the given
+ * mask to the end of dst, keeping their order. */
+bool window_transfer(struct wl_array *dst, struct wl_array *src, uint32_t mask, bool match);
+
 void window_add_config_nodes(void);
 
 struct window *window_new(struct swc_window *swc);
@@ -46,6 +84,7 @@ void window_hide(struct window *window);
 
 void window_set_tag(struct window *window, struct tag *tag);
 void window_set_layer(struct window *window, int layer);
+void window_set_fullscreen(struct window *window, bool fullscreen);
 
 struct window *window_or_focus(const struct variant *v);
 